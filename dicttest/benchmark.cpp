@@ -0,0 +1,379 @@
+﻿// Сравнение производительности реализаций словаря.
+// Запуск: benchmark [число слов] [файл со словами, по одному в строке]
+// По умолчанию — 1000000 случайных слов. Со списком настоящих слов
+// (например, /usr/share/dict/words) общие префиксы вроде "inter..." длиннее,
+// и разница между сравнением по префиксу и по строке заметнее; промахи кэша
+// удобно смотреть через perf stat -e cache-misses. В сборке с -DDICTIONARY_METRICS
+// в конце печатаются счётчики дерева после серии поисков.
+//
+// Выигрыш от сравнения по 8-байтовому префиксу ключа проверяется двумя сборками:
+// обычной и с -DDICTIONARY_PLAIN_COMPARE, где узлы сравниваются строками целиком.
+// На Linux для поиска печатаются ещё и промахи кэша на операцию (perf_event_open;
+// если счётчик недоступен, например без прав или в виртуальной машине, — n/a).
+#include "dictionary.h"
+#include "btree_dictionary.h"
+#include "sharded_dictionary.h"
+#include "compressed_dictionary.h"
+#include "persistent_dictionary.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char* name, const char* operation, size_t operations, double seconds) {
+    std::printf("%-10s %-8s %10.1f ns/op  %8.2f Mop/s\n", name, operation,
+                seconds * 1e9 / operations, operations / seconds / 1e6);
+}
+
+// Аппаратный счётчик промахов последнего уровня кэша для текущего потока
+class CacheMisses {
+private:
+    int fd;
+
+public:
+    CacheMisses() : fd(-1) {
+#ifdef __linux__
+        perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    CacheMisses(const CacheMisses&) = delete;
+    CacheMisses& operator=(const CacheMisses&) = delete;
+    ~CacheMisses() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    // Промахов с создания или -1, если счётчик недоступен
+    long long read() const {
+#ifdef __linux__
+        long long value = 0;
+        if (fd >= 0 && ::read(fd, &value, sizeof(value)) == sizeof(value))
+            return value;
+#endif
+        return -1;
+    }
+};
+
+void reportCacheMisses(const char* name, const char* operation, size_t operations, long long misses) {
+    if (misses < 0)
+        std::printf("%-10s %-8s cache-misses n/a\n", name, operation);
+    else
+        std::printf("%-10s %-8s %10.2f cache-misses/op\n", name, operation, double(misses) / operations);
+}
+
+// Случайные «слова» из строчных букв длиной 4-14
+std::vector<std::string> makeWords(size_t count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> length(4, 14);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::vector<std::string> words(count);
+    for (std::string& word : words) {
+        word.resize(length(random));
+        for (char& c : word)
+            c = static_cast<char>(letter(random));
+    }
+    return words;
+}
+
+// Красно-черное дерево с включённым хеш-индексом
+struct HashedDictionary : EnglishRussianDictionary {
+    HashedDictionary() { enableHashIndex(); }
+};
+
+std::vector<std::string> readWords(const char* filename, size_t limit) {
+    std::vector<std::string> words;
+    std::ifstream file(filename);
+    std::string word;
+    while (words.size() < limit && std::getline(file, word))
+        if (!word.empty())
+            words.push_back(word);
+    return words;
+}
+
+template <typename Dictionary>
+void benchmarkTree(const char* name, const std::vector<std::string>& words,
+                   const std::vector<std::string>& queries) {
+    Dictionary dict;
+
+    Clock::time_point start = Clock::now();
+    for (const std::string& word : words)
+        dict += std::make_pair(word, word);
+    report(name, "insert", words.size(), secondsSince(start));
+
+    size_t found = 0;
+    {
+        CacheMisses misses;
+        start = Clock::now();
+        for (const std::string& query : queries)
+            found += dict.contains(query) ? 1 : 0;
+        report(name, "lookup", queries.size(), secondsSince(start));
+        reportCacheMisses(name, "lookup", queries.size(), misses.read());
+    }
+
+    start = Clock::now();
+    for (const std::string& word : words)
+        dict -= word;
+    report(name, "erase", words.size(), secondsSince(start));
+
+    if (dict.count() != 0 || found == 0)
+        std::printf("unexpected result\n");
+}
+
+// Поиск в сжатом словаре и его размер по сравнению с деревом
+void benchmarkCompressed(const std::vector<std::string>& words, const std::vector<std::string>& queries) {
+    EnglishRussianDictionary dict;
+    for (const std::string& word : words)
+        dict += std::make_pair(word, word);
+    CompressedDictionary compressed = dict.compress();
+
+    size_t found = 0;
+    Clock::time_point start = Clock::now();
+    for (const std::string& query : queries)
+        found += compressed.contains(query) ? 1 : 0;
+    report("compressed", "lookup", queries.size(), secondsSince(start));
+
+    std::printf("compressed %8.1f bytes/word, rb-tree %.1f bytes/word\n",
+                double(compressed.memoryUsage()) / compressed.count(), double(dict.memoryUsage()) / dict.count());
+    if (found == 0)
+        std::printf("unexpected result\n");
+}
+
+// Наложение словаря-дополнения размером в половину основного:
+// по одному слову через += против слияния за линейное время
+void benchmarkMerge(const std::vector<std::string>& words) {
+    EnglishRussianDictionary base, overlay;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (i % 4 != 3)
+            base += std::make_pair(words[i], words[i]);
+        if (i % 2 == 1)
+            overlay += std::make_pair(words[i], "overlay");
+    }
+
+    EnglishRussianDictionary looped(base);
+    Clock::time_point start = Clock::now();
+    overlay.forEach([&looped](std::string_view english, std::string_view russian) {
+        looped += std::make_pair(std::string(english), std::string(russian));
+    });
+    report("merge", "loop", overlay.count(), secondsSince(start));
+
+    EnglishRussianDictionary merged(base);
+    start = Clock::now();
+    merged += overlay;
+    report("merge", "linear", overlay.count(), secondsSince(start));
+    if (merged.count() != looped.count())
+        std::printf("unexpected result\n");
+}
+
+// Правки версионного словаря со снимком после каждой тысячи и память всех
+// версий по сравнению с полными копиями
+void benchmarkVersions(const std::vector<std::string>& words) {
+    EnglishRussianDictionary source;
+    for (const std::string& word : words)
+        source += std::make_pair(word, word);
+    PersistentDictionary dict(source);
+
+    const size_t versions = 30, edits = 1000;
+    std::vector<PersistentDictionary::Snapshot> history;
+    std::mt19937 random(5);
+    Clock::time_point start = Clock::now();
+    for (size_t version = 0; version < versions; ++version) {
+        for (size_t i = 0; i < edits; ++i)
+            dict += std::make_pair(words[random() % words.size()], std::string("edited"));
+        history.push_back(dict.snapshot());
+    }
+    report("versioned", "edit", versions * edits, secondsSince(start));
+
+    size_t shared = PersistentDictionary::memoryUsage(history);
+    size_t single = PersistentDictionary::memoryUsage({ history.back() });
+    std::printf("versioned  %zu versions %.1f MB, full copies %.1f MB\n", versions,
+                shared / 1048576.0, single * double(versions) / 1048576.0);
+}
+
+#ifdef DICTIONARY_METRICS
+// Показатели дерева после поиска всех запросов
+void printMetrics(const std::vector<std::string>& words, const std::vector<std::string>& queries) {
+    EnglishRussianDictionary dict;
+    for (const std::string& word : words)
+        dict += std::make_pair(word, word);
+    dict.resetMetrics();
+    for (const std::string& query : queries)
+        dict.contains(query);
+    std::printf("%s", dict.metrics().toString().c_str());
+}
+#endif
+
+// Нечёткий поиск по словам с одной опечаткой
+void benchmarkSuggest(const std::vector<std::string>& words) {
+    EnglishRussianDictionary dict;
+    for (const std::string& word : words)
+        dict += std::make_pair(word, word);
+
+    std::mt19937 random(4);
+    std::vector<std::string> typos(1000);
+    for (std::string& typo : typos) {
+        typo = words[random() % words.size()];
+        typo[random() % typo.size()] = static_cast<char>('a' + random() % 26);
+    }
+    for (size_t maxDistance : { size_t(1), size_t(2) }) {
+        size_t found = 0;
+        Clock::time_point start = Clock::now();
+        for (const std::string& typo : typos)
+            found += dict.suggest(typo, maxDistance, 5).size();
+        double seconds = secondsSince(start);
+        std::printf("suggest    d=%zu %10.1f us/query  %5.1f results/query\n", maxDistance,
+                    seconds * 1e6 / typos.size(), double(found) / typos.size());
+    }
+}
+
+// Каждый поток добавляет и удаляет свою часть слов; один сегмент равносилен
+// словарю под общей блокировкой
+void benchmarkSharded(const std::vector<std::string>& words) {
+    for (size_t shardCount : { size_t(1), size_t(64) }) {
+        for (size_t threads = 1; threads <= 64; threads *= 2) {
+            ShardedDictionary dict(shardCount);
+            Clock::time_point start = Clock::now();
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&dict, &words, t, threads]() {
+                    for (size_t i = t; i < words.size(); i += threads)
+                        dict += std::make_pair(words[i], words[i]);
+                    for (size_t i = t; i < words.size(); i += threads * 2)
+                        dict -= words[i];
+                });
+            }
+            for (std::thread& worker : workers)
+                worker.join();
+            double seconds = secondsSince(start);
+            size_t operations = words.size() + (words.size() + 1) / 2;
+            std::printf("sharded    %2zu shards %2zu threads %8.2f Mop/s\n", shardCount, threads,
+                        operations / seconds / 1e6);
+        }
+    }
+}
+
+// Загрузка сгенерированного файла: последовательный разбор против параллельного.
+// Файл пишется в текущий каталог и удаляется после замеров.
+void benchmarkLoad(const std::vector<std::string>& words) {
+    const std::string filename = "benchmark_load.txt";
+    {
+        std::ofstream file(filename, std::ios::binary);
+        for (size_t i = 0; i < words.size(); ++i)
+            file << words[i] << '\n' << "перевод_" << i << '\n';
+    }
+
+    using LoadMode = EnglishRussianDictionary::LoadMode;
+    EnglishRussianDictionary dict;
+    Clock::time_point start = Clock::now();
+    dict.load(filename, LoadMode::Copy);
+    report("load", "copy", words.size(), secondsSince(start));
+    start = Clock::now();
+    dict.load(filename, LoadMode::Mapped);
+    report("load", "mapped", words.size(), secondsSince(start));
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        start = Clock::now();
+        dict.loadParallel(filename, threads, LoadMode::Mapped);
+        double seconds = secondsSince(start);
+        std::printf("parallel   %2u threads %10.1f ns/op  %8.2f Mop/s\n", threads,
+                    seconds * 1e9 / words.size(), words.size() / seconds / 1e6);
+    }
+    dict.clear();
+    std::remove(filename.c_str());
+}
+
+size_t fileSize(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+// Выгрузка в текстовый и двоичный формат и обратная загрузка двоичного, в ГБ/с
+void benchmarkSave(const std::vector<std::string>& words) {
+    EnglishRussianDictionary dict;
+    for (size_t i = 0; i < words.size(); ++i)
+        dict += std::make_pair(words[i], "перевод_" + std::to_string(i));
+
+    const std::string filename = "benchmark_save.tmp";
+    auto measure = [&filename](const char* operation, auto action) {
+        Clock::time_point start = Clock::now();
+        action();
+        double seconds = secondsSince(start);
+        std::printf("save       %-12s %8.2f GB/s\n", operation, fileSize(filename) / seconds / 1e9);
+    };
+    measure("text", [&]() { dict.save(filename); });
+    measure("binary", [&]() { dict.saveBinary(filename); });
+    EnglishRussianDictionary loaded;
+    measure("load-binary", [&]() { loaded.loadBinary(filename, EnglishRussianDictionary::LoadMode::Mapped); });
+    loaded.clear();
+    std::remove(filename.c_str());
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::vector<std::string> words = argc > 2 ? readWords(argv[2], count) : makeWords(count, 1);
+    if (words.empty()) {
+        std::printf("no words\n");
+        return 1;
+    }
+    count = words.size();
+
+    // Запросы: половина — существующие слова, половина — промахи
+    std::vector<std::string> queries = makeWords(count / 2, 2);
+    std::mt19937 random(3);
+    for (size_t i = 0; i < count / 2; ++i)
+        queries.push_back(words[random() % words.size()]);
+    std::shuffle(queries.begin(), queries.end(), random);
+
+#ifdef DICTIONARY_PLAIN_COMPARE
+    std::printf("%zu words, plain key compare\n", count);
+#else
+    std::printf("%zu words, 8-byte key prefix compare\n", count);
+#endif
+    benchmarkTree<EnglishRussianDictionary>("rb-tree", words, queries);
+    benchmarkTree<HashedDictionary>("rb+hash", words, queries);
+    benchmarkTree<BTreeDictionary>("b+tree", words, queries);
+    benchmarkCompressed(words, queries);
+    benchmarkSuggest(words);
+    benchmarkMerge(words);
+    benchmarkVersions(words);
+    benchmarkSharded(words);
+    benchmarkLoad(words);
+    benchmarkSave(words);
+#ifdef DICTIONARY_METRICS
+    printMetrics(words, queries);
+#endif
+    return 0;
+}
@@ -0,0 +1,61 @@
+﻿#include "bloom_filter.h"
+#include "key_hash.h"
+
+BloomFilter::BloomFilter(size_t expectedKeys)
+    : capacity(0) {
+    reset(expectedKeys);
+}
+
+void BloomFilter::reset(size_t expectedKeys) {
+    // 512 бит на блок, около 10 бит на ключ
+    size_t blockCount = expectedKeys * 10 / 512 + 1;
+    blocks.assign(blockCount, Block());
+    capacity = expectedKeys;
+}
+
+// Старшие 32 бита хеша выбирают блок, перемешанный хеш даёт 7 позиций по 9 бит
+void BloomFilter::add(uint64_t hash) {
+    Block& block = blocks[((hash >> 32) * blocks.size()) >> 32];
+    uint64_t bits = mixHash(hash);
+    for (unsigned i = 0; i < bitsPerKey; ++i) {
+        unsigned position = static_cast<unsigned>(bits & 511);
+        block.words[position >> 6] |= uint64_t(1) << (position & 63);
+        bits >>= 9;
+    }
+}
+
+bool BloomFilter::mayContain(uint64_t hash) const {
+    bool counted = sampled(hash);
+    if (counted) queries.fetch_add(1, std::memory_order_relaxed);
+    const Block& block = blocks[((hash >> 32) * blocks.size()) >> 32];
+    uint64_t bits = mixHash(hash);
+    for (unsigned i = 0; i < bitsPerKey; ++i) {
+        unsigned position = static_cast<unsigned>(bits & 511);
+        if (!(block.words[position >> 6] & (uint64_t(1) << (position & 63)))) {
+            if (counted) rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        bits >>= 9;
+    }
+    return true;
+}
+
+void BloomFilter::recordFalsePositive(uint64_t hash) const {
+    if (sampled(hash)) falsePositives.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t BloomFilter::sizedFor() const {
+    return capacity;
+}
+
+// Доля ложных срабатываний среди запросов отсутствующих слов
+BloomFilter::Stats BloomFilter::stats() const {
+    Stats result = Stats();
+    result.queries = queries.load(std::memory_order_relaxed) * sampling;
+    result.rejected = rejected.load(std::memory_order_relaxed) * sampling;
+    result.falsePositives = falsePositives.load(std::memory_order_relaxed) * sampling;
+    uint64_t negatives = result.rejected + result.falsePositives;
+    result.falsePositiveRate = negatives ? static_cast<double>(result.falsePositives) / negatives : 0.0;
+    result.bytes = blocks.size() * sizeof(Block);
+    return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Блочный фильтр Блума: все биты ключа лежат в одном 64-байтном блоке,
+// поэтому проверка стоит одного промаха кэша. Из фильтра нельзя удалять,
+// его перестраивают целиком.
+class BloomFilter {
+public:
+    // Счётчики накапливаются с момента создания фильтра, перестройки их не сбрасывают.
+    // Считаются только ключи из выборки — один из sampling по младшим битам хеша:
+    // общий атомарный счётчик на каждую проверку гонял бы строку кэша между
+    // потоками-читателями. Числа в Stats — оценки по выборке, умноженной на sampling;
+    // доля ложных срабатываний по выборке не смещена.
+    static const unsigned sampling = 16;
+
+    struct Stats {
+        uint64_t queries;        // проверок
+        uint64_t rejected;       // отсечено фильтром
+        uint64_t falsePositives; // фильтр пропустил, а слова нет
+        double falsePositiveRate;
+        size_t bytes;
+    };
+
+private:
+    struct alignas(64) Block {
+        uint64_t words[8];
+    };
+
+    static const unsigned bitsPerKey = 7;
+
+    std::vector<Block> blocks;
+    size_t capacity; // число ключей, под которое подобран размер
+    mutable std::atomic<uint64_t> queries{ 0 };
+    mutable std::atomic<uint64_t> rejected{ 0 };
+    mutable std::atomic<uint64_t> falsePositives{ 0 };
+
+    static bool sampled(uint64_t hash) { return (hash & (sampling - 1)) == 0; }
+
+public:
+    explicit BloomFilter(size_t expectedKeys = 0);
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+
+    // Очищает фильтр и подбирает размер (~10 бит на ключ, ~1% ложных срабатываний)
+    void reset(size_t expectedKeys);
+    void add(uint64_t hash);
+    bool mayContain(uint64_t hash) const;
+    // Сообщает, что пропущенный фильтром ключ с хешем hash не нашёлся
+    void recordFalsePositive(uint64_t hash) const;
+
+    size_t sizedFor() const;
+    Stats stats() const;
+};
+
+#endif
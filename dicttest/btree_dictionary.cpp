@@ -0,0 +1,390 @@
+﻿#include "btree_dictionary.h"
+#include <fstream>
+
+BTreeDictionary::BTreeDictionary() : root(nullptr), size(0) {
+    root = leaves.create();
+}
+
+BTreeDictionary::~BTreeDictionary() {
+    clear(root);
+}
+
+// Вызывает только деструкторы узлов; память возвращается пулами целиком
+void BTreeDictionary::clear(NodeBase* node) {
+    if (node->isLeaf) {
+        static_cast<Leaf*>(node)->~Leaf();
+        return;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    for (unsigned i = 0; i <= inner->count; ++i)
+        clear(inner->children[i]);
+    inner->~Inner();
+}
+
+void BTreeDictionary::clear() {
+    clear(root);
+    leaves.release();
+    inners.release();
+    root = leaves.create();
+    size = 0;
+}
+
+unsigned BTreeDictionary::lowerBound(const std::string* keys, unsigned count, std::string_view key) {
+    unsigned lo = 0, hi = count;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        if (std::string_view(keys[mid]) < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+unsigned BTreeDictionary::upperBound(const std::string* keys, unsigned count, std::string_view key) {
+    unsigned lo = 0, hi = count;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        if (key < std::string_view(keys[mid]))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+BTreeDictionary::Leaf* BTreeDictionary::findLeaf(std::string_view key) const {
+    NodeBase* node = root;
+    while (!node->isLeaf) {
+        Inner* inner = static_cast<Inner*>(node);
+        node = inner->children[upperBound(inner->keys, inner->count, key)];
+    }
+    return static_cast<Leaf*>(node);
+}
+
+// Вставляет слово в поддерево и возвращает указатель на его перевод.
+// Если узел переполнился, он делится, и split сообщает о новом правом соседе.
+std::string* BTreeDictionary::insert(NodeBase* node, std::string_view key, std::string_view value,
+                                     bool overwrite, std::optional<Split>& split) {
+    if (node->isLeaf) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        unsigned pos = lowerBound(leaf->keys, leaf->count, key);
+        if (pos < leaf->count && std::string_view(leaf->keys[pos]) == key) {
+            if (overwrite)
+                leaf->values[pos].assign(value.data(), value.size());
+            return &leaf->values[pos];
+        }
+
+        for (unsigned i = leaf->count; i > pos; --i) {
+            leaf->keys[i] = std::move(leaf->keys[i - 1]);
+            leaf->values[i] = std::move(leaf->values[i - 1]);
+        }
+        leaf->keys[pos].assign(key.data(), key.size());
+        leaf->values[pos].assign(value.data(), value.size());
+        leaf->count++;
+        size++;
+        if (leaf->count <= leafCapacity)
+            return &leaf->values[pos];
+
+        Leaf* right = leaves.create();
+        unsigned half = leaf->count / 2;
+        for (unsigned i = half; i < leaf->count; ++i) {
+            right->keys[i - half] = std::move(leaf->keys[i]);
+            right->values[i - half] = std::move(leaf->values[i]);
+        }
+        right->count = leaf->count - half;
+        leaf->count = half;
+        right->next = leaf->next;
+        leaf->next = right;
+        split = Split{ right->keys[0], right };
+        return pos < half ? &leaf->values[pos] : &right->values[pos - half];
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+    unsigned index = upperBound(inner->keys, inner->count, key);
+    std::optional<Split> childSplit;
+    std::string* result = insert(inner->children[index], key, value, overwrite, childSplit);
+    if (!childSplit)
+        return result;
+
+    for (unsigned i = inner->count; i > index; --i) {
+        inner->keys[i] = std::move(inner->keys[i - 1]);
+        inner->children[i + 1] = inner->children[i];
+    }
+    inner->keys[index] = std::move(childSplit->separator);
+    inner->children[index + 1] = childSplit->right;
+    inner->count++;
+    if (inner->count <= innerCapacity)
+        return result;
+
+    // Средний ключ поднимается к родителю
+    Inner* right = inners.create();
+    unsigned mid = inner->count / 2;
+    for (unsigned i = mid + 1; i < inner->count; ++i)
+        right->keys[i - mid - 1] = std::move(inner->keys[i]);
+    for (unsigned i = mid + 1; i <= inner->count; ++i)
+        right->children[i - mid - 1] = inner->children[i];
+    right->count = inner->count - mid - 1;
+    inner->count = mid;
+    split = Split{ std::move(inner->keys[mid]), right };
+    return result;
+}
+
+std::string* BTreeDictionary::insertRoot(std::string_view key, std::string_view value, bool overwrite) {
+    std::optional<Split> split;
+    std::string* result = insert(root, key, value, overwrite, split);
+    if (split) {
+        Inner* newRoot = inners.create();
+        newRoot->keys[0] = std::move(split->separator);
+        newRoot->children[0] = root;
+        newRoot->children[1] = split->right;
+        newRoot->count = 1;
+        root = newRoot;
+    }
+    return result;
+}
+
+bool BTreeDictionary::erase(NodeBase* node, std::string_view key) {
+    if (node->isLeaf) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        unsigned pos = lowerBound(leaf->keys, leaf->count, key);
+        if (pos == leaf->count || std::string_view(leaf->keys[pos]) != key)
+            return false;
+        for (unsigned i = pos + 1; i < leaf->count; ++i) {
+            leaf->keys[i - 1] = std::move(leaf->keys[i]);
+            leaf->values[i - 1] = std::move(leaf->values[i]);
+        }
+        leaf->count--;
+        leaf->keys[leaf->count].clear();
+        leaf->values[leaf->count].clear();
+        size--;
+        return true;
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+    unsigned index = upperBound(inner->keys, inner->count, key);
+    if (!erase(inner->children[index], key))
+        return false;
+    NodeBase* child = inner->children[index];
+    unsigned minKeys = child->isLeaf ? leafCapacity / 2 : innerCapacity / 2;
+    if (child->count < minKeys)
+        rebalance(inner, index);
+    return true;
+}
+
+// Восстанавливает заполненность ребёнка index: занимает ключ у соседа,
+// а если соседи заполнены минимально — сливается с одним из них
+void BTreeDictionary::rebalance(Inner* parent, unsigned index) {
+    NodeBase* child = parent->children[index];
+    NodeBase* left = index > 0 ? parent->children[index - 1] : nullptr;
+    NodeBase* right = index < parent->count ? parent->children[index + 1] : nullptr;
+    unsigned minKeys = child->isLeaf ? leafCapacity / 2 : innerCapacity / 2;
+
+    if (left && left->count > minKeys) {
+        if (child->isLeaf) {
+            Leaf* to = static_cast<Leaf*>(child);
+            Leaf* from = static_cast<Leaf*>(left);
+            for (unsigned i = to->count; i > 0; --i) {
+                to->keys[i] = std::move(to->keys[i - 1]);
+                to->values[i] = std::move(to->values[i - 1]);
+            }
+            from->count--;
+            to->keys[0] = std::move(from->keys[from->count]);
+            to->values[0] = std::move(from->values[from->count]);
+            to->count++;
+            parent->keys[index - 1] = to->keys[0];
+        }
+        else {
+            Inner* to = static_cast<Inner*>(child);
+            Inner* from = static_cast<Inner*>(left);
+            for (unsigned i = to->count; i > 0; --i)
+                to->keys[i] = std::move(to->keys[i - 1]);
+            for (unsigned i = to->count + 1; i > 0; --i)
+                to->children[i] = to->children[i - 1];
+            to->keys[0] = std::move(parent->keys[index - 1]);
+            to->children[0] = from->children[from->count];
+            to->count++;
+            from->count--;
+            parent->keys[index - 1] = std::move(from->keys[from->count]);
+        }
+        return;
+    }
+
+    if (right && right->count > minKeys) {
+        if (child->isLeaf) {
+            Leaf* to = static_cast<Leaf*>(child);
+            Leaf* from = static_cast<Leaf*>(right);
+            to->keys[to->count] = std::move(from->keys[0]);
+            to->values[to->count] = std::move(from->values[0]);
+            to->count++;
+            for (unsigned i = 1; i < from->count; ++i) {
+                from->keys[i - 1] = std::move(from->keys[i]);
+                from->values[i - 1] = std::move(from->values[i]);
+            }
+            from->count--;
+            parent->keys[index] = from->keys[0];
+        }
+        else {
+            Inner* to = static_cast<Inner*>(child);
+            Inner* from = static_cast<Inner*>(right);
+            to->keys[to->count] = std::move(parent->keys[index]);
+            to->children[to->count + 1] = from->children[0];
+            to->count++;
+            parent->keys[index] = std::move(from->keys[0]);
+            for (unsigned i = 1; i < from->count; ++i)
+                from->keys[i - 1] = std::move(from->keys[i]);
+            for (unsigned i = 1; i <= from->count; ++i)
+                from->children[i - 1] = from->children[i];
+            from->count--;
+        }
+        return;
+    }
+
+    // Слияние детей at и at + 1
+    unsigned at = right ? index : index - 1;
+    NodeBase* first = parent->children[at];
+    NodeBase* second = parent->children[at + 1];
+    if (first->isLeaf) {
+        Leaf* to = static_cast<Leaf*>(first);
+        Leaf* from = static_cast<Leaf*>(second);
+        for (unsigned i = 0; i < from->count; ++i) {
+            to->keys[to->count + i] = std::move(from->keys[i]);
+            to->values[to->count + i] = std::move(from->values[i]);
+        }
+        to->count += from->count;
+        to->next = from->next;
+        leaves.destroy(from);
+    }
+    else {
+        Inner* to = static_cast<Inner*>(first);
+        Inner* from = static_cast<Inner*>(second);
+        to->keys[to->count] = std::move(parent->keys[at]);
+        for (unsigned i = 0; i < from->count; ++i)
+            to->keys[to->count + 1 + i] = std::move(from->keys[i]);
+        for (unsigned i = 0; i <= from->count; ++i)
+            to->children[to->count + 1 + i] = from->children[i];
+        to->count += from->count + 1;
+        inners.destroy(from);
+    }
+    for (unsigned i = at + 1; i < parent->count; ++i) {
+        parent->keys[i - 1] = std::move(parent->keys[i]);
+        parent->children[i] = parent->children[i + 1];
+    }
+    parent->count--;
+}
+
+BTreeDictionary& BTreeDictionary::operator+=(const std::pair<const char*, const char*>& words) {
+    insertRoot(words.first, words.second, true);
+    return *this;
+}
+
+BTreeDictionary& BTreeDictionary::operator+=(const std::pair<std::string, std::string>& words) {
+    insertRoot(words.first, words.second, true);
+    return *this;
+}
+
+BTreeDictionary& BTreeDictionary::operator-=(const char* english) {
+    return *this -= std::string(english);
+}
+
+BTreeDictionary& BTreeDictionary::operator-=(const std::string& english) {
+    erase(root, english);
+    if (!root->isLeaf && root->count == 0) {
+        Inner* old = static_cast<Inner*>(root);
+        root = old->children[0];
+        inners.destroy(old);
+    }
+    return *this;
+}
+
+std::string BTreeDictionary::operator[](const char* english) const {
+    std::optional<std::string_view> russian = find(english);
+    return russian ? std::string(*russian) : std::string();
+}
+
+std::string BTreeDictionary::operator[](const std::string& english) const {
+    std::optional<std::string_view> russian = find(english);
+    return russian ? std::string(*russian) : std::string();
+}
+
+std::string& BTreeDictionary::operator[](const char* english) {
+    return *insertRoot(english, std::string_view(), false);
+}
+
+std::string& BTreeDictionary::operator[](const std::string& english) {
+    return *insertRoot(english, std::string_view(), false);
+}
+
+std::optional<std::string_view> BTreeDictionary::find(std::string_view english) const {
+    const Leaf* leaf = findLeaf(english);
+    unsigned pos = lowerBound(leaf->keys, leaf->count, english);
+    if (pos == leaf->count || std::string_view(leaf->keys[pos]) != english)
+        return std::nullopt;
+    return std::string_view(leaf->values[pos]);
+}
+
+bool BTreeDictionary::contains(std::string_view english) const {
+    return find(english).has_value();
+}
+
+size_t BTreeDictionary::count() const {
+    return size;
+}
+
+bool BTreeDictionary::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) return false;
+
+    clear();
+
+    std::string eng, rus;
+    while (std::getline(file, eng) && std::getline(file, rus)) {
+        insertRoot(eng, rus, true);
+    }
+
+    file.close();
+    return true;
+}
+
+// Возвращает глубину листьев поддерева или -1 при нарушении свойств.
+// Все ключи поддерева должны лежать в [low, high).
+int BTreeDictionary::checkSubtree(const NodeBase* node, const std::string* low, const std::string* high,
+                                  bool isRoot) const {
+    unsigned capacity = node->isLeaf ? leafCapacity : innerCapacity;
+    if (node->count > capacity) return -1;
+    if (!isRoot && node->count < capacity / 2) return -1;
+
+    const std::string* keys = node->isLeaf ? static_cast<const Leaf*>(node)->keys
+                                           : static_cast<const Inner*>(node)->keys;
+    for (unsigned i = 0; i < node->count; ++i) {
+        if (i > 0 && !(keys[i - 1] < keys[i])) return -1;
+        if (low && keys[i] < *low) return -1;
+        if (high && !(keys[i] < *high)) return -1;
+    }
+    if (node->isLeaf) return 0;
+
+    const Inner* inner = static_cast<const Inner*>(node);
+    if (inner->count == 0) return -1;
+    int depth = -1;
+    for (unsigned i = 0; i <= inner->count; ++i) {
+        const std::string* childLow = i > 0 ? &inner->keys[i - 1] : low;
+        const std::string* childHigh = i < inner->count ? &inner->keys[i] : high;
+        int childDepth = checkSubtree(inner->children[i], childLow, childHigh, false);
+        if (childDepth < 0 || (depth >= 0 && childDepth != depth)) return -1;
+        depth = childDepth;
+    }
+    return depth + 1;
+}
+
+bool BTreeDictionary::validate() const {
+    if (checkSubtree(root, nullptr, nullptr, true) < 0) return false;
+    size_t seen = 0;
+    bool ordered = true;
+    std::string_view previous;
+    forEach([&](std::string_view english, std::string_view) {
+        if (seen > 0 && !(previous < english)) ordered = false;
+        previous = english;
+        seen++;
+    });
+    return ordered && seen == size;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef BTREE_DICTIONARY_H
+#define BTREE_DICTIONARY_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "node_pool.h"
+
+// Словарь на B+-дереве с тем же интерфейсом, что и EnglishRussianDictionary.
+// Широкие узлы (лист ~2 КБ) читаются последовательно, поэтому на уровень
+// приходится несколько соседних строк кэша вместо одной случайной,
+// а высота дерева на 2 млн слов — 4-5 уровней вместо ~21.
+// Ссылки и представления на переводы действительны до следующего изменения словаря.
+class BTreeDictionary {
+private:
+    static const unsigned leafCapacity = 32;
+    static const unsigned innerCapacity = 32;
+
+    struct NodeBase {
+        bool isLeaf;
+        unsigned count; // число ключей
+        explicit NodeBase(bool leaf) : isLeaf(leaf), count(0) {}
+    };
+
+    // Массивы на один элемент больше ёмкости: переполненный узел сначала
+    // заполняется, а затем делится пополам
+    struct Leaf : NodeBase {
+        std::string keys[leafCapacity + 1];
+        std::string values[leafCapacity + 1];
+        Leaf* next;
+        Leaf() : NodeBase(true), next(nullptr) {}
+    };
+
+    struct Inner : NodeBase {
+        std::string keys[innerCapacity + 1];
+        NodeBase* children[innerCapacity + 2];
+        Inner() : NodeBase(false) {}
+    };
+
+    // Результат деления узла: разделитель и новый правый сосед
+    struct Split {
+        std::string separator;
+        NodeBase* right;
+    };
+
+    NodeBase* root;
+    size_t size;
+    NodePool<Leaf> leaves;
+    NodePool<Inner> inners;
+
+    static unsigned lowerBound(const std::string* keys, unsigned count, std::string_view key);
+    static unsigned upperBound(const std::string* keys, unsigned count, std::string_view key);
+
+    Leaf* findLeaf(std::string_view key) const;
+    std::string* insert(NodeBase* node, std::string_view key, std::string_view value,
+                        bool overwrite, std::optional<Split>& split);
+    std::string* insertRoot(std::string_view key, std::string_view value, bool overwrite);
+    bool erase(NodeBase* node, std::string_view key);
+    void rebalance(Inner* parent, unsigned index);
+    void clear(NodeBase* node);
+
+public:
+    BTreeDictionary();
+    ~BTreeDictionary();
+
+    BTreeDictionary(const BTreeDictionary&) = delete;
+    BTreeDictionary& operator=(const BTreeDictionary&) = delete;
+
+    BTreeDictionary& operator+=(const std::pair<const char*, const char*>& words);
+    BTreeDictionary& operator+=(const std::pair<std::string, std::string>& words);
+    BTreeDictionary& operator-=(const char* english);
+    BTreeDictionary& operator-=(const std::string& english);
+    std::string operator[](const char* english) const;
+    std::string operator[](const std::string& english) const;
+    std::string& operator[](const char* english);
+    std::string& operator[](const std::string& english);
+
+    std::optional<std::string_view> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+
+    size_t count() const;
+    void clear();
+    bool load(const std::string& filename);
+
+    // Обход в порядке возрастания ключей по цепочке листьев: visit(english, russian)
+    template <typename Visitor>
+    void forEach(Visitor visit) const;
+
+    // Проверка свойств B+-дерева (для тестов)
+    bool validate() const;
+
+private:
+    int checkSubtree(const NodeBase* node, const std::string* low, const std::string* high,
+                     bool isRoot) const;
+};
+
+template <typename Visitor>
+void BTreeDictionary::forEach(Visitor visit) const {
+    const NodeBase* node = root;
+    while (!node->isLeaf)
+        node = static_cast<const Inner*>(node)->children[0];
+    for (const Leaf* leaf = static_cast<const Leaf*>(node); leaf; leaf = leaf->next)
+        for (unsigned i = 0; i < leaf->count; ++i)
+            visit(std::string_view(leaf->keys[i]), std::string_view(leaf->values[i]));
+}
+
+#endif
@@ -0,0 +1,130 @@
+﻿#include "compressed_dictionary.h"
+#include "mapped_file.h"
+#include "parallel_parser.h"
+#include <algorithm>
+
+namespace {
+
+void writeVarint(std::vector<char>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+}
+
+CompressedDictionary::CompressedDictionary() : n(0) {}
+
+CompressedDictionary::CompressedDictionary(const std::vector<std::pair<std::string_view, std::string_view>>& sorted)
+    : n(sorted.size()) {
+    restarts.reserve((n + blockSize - 1) / blockSize);
+    std::string_view previous;
+    for (size_t i = 0; i < n; ++i) {
+        std::string_view key = sorted[i].first;
+        std::string_view value = sorted[i].second;
+        size_t shared = 0;
+        if (i % blockSize == 0) {
+            restarts.push_back(Restart{ keys.size(), values.size() });
+        }
+        else {
+            size_t limit = std::min(previous.size(), key.size());
+            while (shared < limit && previous[shared] == key[shared])
+                shared++;
+        }
+        writeVarint(keys, shared);
+        writeVarint(keys, key.size() - shared);
+        keys.insert(keys.end(), key.begin() + shared, key.end());
+        writeVarint(keys, value.size());
+        values.insert(values.end(), value.begin(), value.end());
+        previous = key;
+    }
+    keys.shrink_to_fit();
+    values.shrink_to_fit();
+}
+
+bool CompressedDictionary::load(const std::string& filename, unsigned threads) {
+    MappedFile file;
+    if (!file.open(filename)) return false;
+    *this = CompressedDictionary(parseSortedPairs(file.data(), file.size(), threads));
+    return true;
+}
+
+// Первое слово блока хранится целиком: общая длина 0
+std::string_view CompressedDictionary::restartKey(size_t block) const {
+    const char* pos = keys.data() + restarts[block].keyOffset;
+    readVarint(pos);
+    size_t length = readVarint(pos);
+    return std::string_view(pos, length);
+}
+
+// Последний блок, чьё первое слово не больше english, или restarts.size(), если такого нет
+size_t CompressedDictionary::findBlock(std::string_view english) const {
+    size_t lo = 0, hi = restarts.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (english < restartKey(mid))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo == 0 ? restarts.size() : lo - 1;
+}
+
+// Слова блока сравниваются с искомым без восстановления: достаточно знать,
+// сколько первых символов предыдущего слова совпало с искомым (matched).
+// Слово с большим общим префиксом совпадает с предыдущим дальше и потому
+// всё ещё меньше искомого; с меньшим — уже больше, и искать дальше незачем.
+std::optional<std::string_view> CompressedDictionary::find(std::string_view english) const {
+    size_t block = findBlock(english);
+    if (block == restarts.size()) return std::nullopt;
+
+    const char* pos = keys.data() + restarts[block].keyOffset;
+    const char* value = values.data() + restarts[block].valueOffset;
+    size_t entries = std::min(blockSize, n - block * blockSize);
+    size_t matched = 0;
+    for (size_t i = 0; i < entries; ++i) {
+        size_t shared = readVarint(pos);
+        size_t suffixLength = readVarint(pos);
+        const char* suffix = pos;
+        pos += suffixLength;
+        size_t valueLength = readVarint(pos);
+
+        if (shared < matched) return std::nullopt;
+        if (shared == matched) {
+            std::string_view rest = english.substr(matched);
+            size_t common = 0;
+            size_t limit = std::min(rest.size(), suffixLength);
+            while (common < limit && rest[common] == suffix[common])
+                common++;
+            if (common == suffixLength && common == rest.size())
+                return std::string_view(value, valueLength);
+            // Слово больше искомого: оно длиннее совпавшей части или его символ больше
+            if (common == rest.size() ||
+                (common < suffixLength && static_cast<unsigned char>(suffix[common]) >
+                                              static_cast<unsigned char>(rest[common])))
+                return std::nullopt;
+            matched += common;
+        }
+        value += valueLength;
+    }
+    return std::nullopt;
+}
+
+std::string CompressedDictionary::operator[](std::string_view english) const {
+    std::optional<std::string_view> russian = find(english);
+    return russian ? std::string(*russian) : std::string();
+}
+
+bool CompressedDictionary::contains(std::string_view english) const {
+    return find(english).has_value();
+}
+
+size_t CompressedDictionary::count() const {
+    return n;
+}
+
+size_t CompressedDictionary::memoryUsage() const {
+    return keys.capacity() + values.capacity() + restarts.capacity() * sizeof(Restart);
+}
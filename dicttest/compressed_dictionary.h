@@ -0,0 +1,84 @@
+#pragma once
+#ifndef COMPRESSED_DICTIONARY_H
+#define COMPRESSED_DICTIONARY_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Неизменяемый словарь со сжатыми ключами. Отсортированные слова разбиты
+// на блоки по blockSize; первое слово блока (точка рестарта) хранится целиком,
+// остальные — как длина общего с предыдущим словом префикса и остаток (front coding).
+// Переводы лежат подряд в одном массиве, их длины — в потоке ключей.
+//
+// Поиск: двоичный поиск по первым словам блоков, затем просмотр одного блока
+// без восстановления слов — O(log n + blockSize).
+class CompressedDictionary {
+private:
+    struct Restart {
+        uint64_t keyOffset;   // начало блока в keys
+        uint64_t valueOffset; // перевод первого слова блока в values
+    };
+
+    std::vector<char> keys;     // varint общая длина, varint длина остатка, остаток, varint длина перевода
+    std::vector<char> values;   // переводы подряд
+    std::vector<Restart> restarts;
+    size_t n;
+
+    static size_t readVarint(const char*& pos);
+    std::string_view restartKey(size_t block) const;
+    size_t findBlock(std::string_view english) const;
+
+public:
+    static constexpr size_t blockSize = 16;
+
+    CompressedDictionary();
+    // sorted — пары с уникальными ключами в порядке возрастания
+    explicit CompressedDictionary(const std::vector<std::pair<std::string_view, std::string_view>>& sorted);
+
+    // Строит словарь прямо из текстового файла, минуя дерево
+    bool load(const std::string& filename, unsigned threads = 0);
+
+    std::string operator[](std::string_view english) const;
+    std::optional<std::string_view> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+    size_t count() const;
+    // Байт, занятых ключами, переводами и точками рестарта
+    size_t memoryUsage() const;
+
+    // Обход в порядке возрастания ключей: visit(english, russian).
+    // Слово восстанавливается во временный буфер и действительно только внутри visit.
+    template <typename Visitor>
+    void forEach(Visitor visit) const;
+};
+
+inline size_t CompressedDictionary::readVarint(const char*& pos) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(*pos++);
+        value |= size_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+template <typename Visitor>
+void CompressedDictionary::forEach(Visitor visit) const {
+    std::string key;
+    const char* pos = keys.data();
+    const char* value = values.data();
+    for (size_t i = 0; i < n; ++i) {
+        size_t shared = readVarint(pos);
+        size_t suffix = readVarint(pos);
+        key.resize(shared);
+        key.append(pos, suffix);
+        pos += suffix;
+        size_t valueLength = readVarint(pos);
+        visit(std::string_view(key), std::string_view(value, valueLength));
+        value += valueLength;
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+﻿#include "concurrent_dictionary.h"
+#include <functional>
+#include <thread>
+
+ConcurrentDictionary::ConcurrentDictionary() : leftRight(0), versionIndex(0) {
+    instances[0].reset(new EnglishRussianDictionary());
+    instances[1].reset(new EnglishRussianDictionary());
+}
+
+ConcurrentDictionary::ConcurrentDictionary(const EnglishRussianDictionary& initial)
+    : leftRight(0), versionIndex(0) {
+    instances[0].reset(new EnglishRussianDictionary(initial));
+    instances[1].reset(new EnglishRussianDictionary(initial));
+}
+
+// Потоки распределяются по счётчикам, чтобы не делить одну строку кэша
+size_t ConcurrentDictionary::readerSlot() {
+    static thread_local size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % readerSlots;
+    return slot;
+}
+
+int ConcurrentDictionary::arrive() const {
+    int version = versionIndex.load();
+    indicators[version][readerSlot()].readers.fetch_add(1);
+    return version;
+}
+
+void ConcurrentDictionary::depart(int version) const {
+    indicators[version][readerSlot()].readers.fetch_sub(1);
+}
+
+void ConcurrentDictionary::waitForReaders(int version) const {
+    for (size_t i = 0; i < readerSlots; ++i) {
+        while (indicators[version][i].readers.load() != 0)
+            std::this_thread::yield();
+    }
+}
+
+// Переключает читателей на копию next и ждёт, пока старую копию никто не читает
+void ConcurrentDictionary::publish(int next) {
+    leftRight.store(next);
+    int previous = versionIndex.load();
+    waitForReaders(1 - previous);
+    versionIndex.store(1 - previous);
+    waitForReaders(previous);
+}
+
+std::string ConcurrentDictionary::operator[](std::string_view english) const {
+    std::optional<std::string> russian = find(english);
+    return russian ? *russian : std::string();
+}
+
+std::optional<std::string> ConcurrentDictionary::find(std::string_view english) const {
+    return read([english](const EnglishRussianDictionary& dict) -> std::optional<std::string> {
+        std::optional<std::string_view> russian = dict.find(english);
+        if (!russian) return std::nullopt;
+        return std::string(*russian);
+    });
+}
+
+bool ConcurrentDictionary::contains(std::string_view english) const {
+    return read([english](const EnglishRussianDictionary& dict) { return dict.contains(english); });
+}
+
+size_t ConcurrentDictionary::count() const {
+    return read([](const EnglishRussianDictionary& dict) { return dict.count(); });
+}
+
+ConcurrentDictionary& ConcurrentDictionary::operator+=(const std::pair<std::string, std::string>& words) {
+    update([&words](EnglishRussianDictionary& dict) { dict += words; });
+    return *this;
+}
+
+ConcurrentDictionary& ConcurrentDictionary::operator-=(const std::string& english) {
+    update([&english](EnglishRussianDictionary& dict) { dict -= english; });
+    return *this;
+}
+
+// Обе новые копии строятся до взятия блокировки; под ней меняются только указатели,
+// а старые деревья удаляются уже после её снятия
+void ConcurrentDictionary::install(std::unique_ptr<EnglishRussianDictionary> fresh) {
+    std::unique_ptr<EnglishRussianDictionary> twin(new EnglishRussianDictionary(*fresh));
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        int current = leftRight.load();
+        instances[1 - current].swap(fresh);
+        publish(1 - current);
+        instances[current].swap(twin);
+    }
+}
+
+bool ConcurrentDictionary::load(const std::string& filename, EnglishRussianDictionary::LoadMode mode) {
+    std::unique_ptr<EnglishRussianDictionary> fresh(new EnglishRussianDictionary());
+    if (!fresh->load(filename, mode)) return false;
+    install(std::move(fresh));
+    return true;
+}
+
+std::future<bool> ConcurrentDictionary::reloadAsync(const std::string& filename,
+                                                    EnglishRussianDictionary::LoadMode mode) {
+    return std::async(std::launch::async, [this, filename, mode]() { return load(filename, mode); });
+}
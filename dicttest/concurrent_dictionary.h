@@ -0,0 +1,103 @@
+#pragma once
+#ifndef CONCURRENT_DICTIONARY_H
+#define CONCURRENT_DICTIONARY_H
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "dictionary.h"
+
+// Словарь для многих читателей и одного писателя по схеме Left-Right:
+// хранятся две копии дерева. Писатель изменяет копию, которую никто не читает,
+// переключает на неё читателей, дожидается ухода читателей со старой копии
+// и повторяет изменение на ней. Читатели никогда не ждут и не берут блокировок:
+// вход и выход — атомарный счётчик в собственной строке кэша.
+//
+// Прямое копирование пути при изменении невозможно: узлы дерева хранят
+// указатели на родителей, поэтому копия пути потянула бы за собой всё дерево.
+// Здесь изменение стоит O(log n) дважды, а памяти уходит вдвое больше.
+class ConcurrentDictionary {
+private:
+    static const size_t readerSlots = 64;
+
+    struct alignas(64) ReadIndicator {
+        std::atomic<long> readers;
+        ReadIndicator() : readers(0) {}
+    };
+
+    std::unique_ptr<EnglishRussianDictionary> instances[2];
+    std::atomic<int> leftRight;    // какую копию читают
+    std::atomic<int> versionIndex; // в какой набор счётчиков отмечаются читатели
+    mutable ReadIndicator indicators[2][readerSlots];
+    std::mutex writeMutex;
+
+    static size_t readerSlot();
+    int arrive() const;
+    void depart(int version) const;
+    void waitForReaders(int version) const;
+    void publish(int next);
+    void install(std::unique_ptr<EnglishRussianDictionary> fresh);
+
+    struct ReadGuard {
+        const ConcurrentDictionary* owner;
+        int version;
+        ~ReadGuard() { owner->depart(version); }
+    };
+
+public:
+    ConcurrentDictionary();
+    explicit ConcurrentDictionary(const EnglishRussianDictionary& initial);
+
+    ConcurrentDictionary(const ConcurrentDictionary&) = delete;
+    ConcurrentDictionary& operator=(const ConcurrentDictionary&) = delete;
+
+    // Выполняет reader над текущей версией; ссылки на её содержимое
+    // нельзя выносить за пределы reader
+    template <typename Reader>
+    auto read(Reader reader) const -> decltype(reader(std::declval<const EnglishRussianDictionary&>()));
+
+    // Применяет writer к обеим копиям по очереди. writer должен давать
+    // одинаковый результат при повторном вызове и не бросать исключений.
+    template <typename Writer>
+    void update(Writer writer);
+
+    std::string operator[](std::string_view english) const;
+    std::optional<std::string> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+    size_t count() const;
+
+    ConcurrentDictionary& operator+=(const std::pair<std::string, std::string>& words);
+    ConcurrentDictionary& operator-=(const std::string& english);
+    bool load(const std::string& filename,
+              EnglishRussianDictionary::LoadMode mode = EnglishRussianDictionary::LoadMode::Copy);
+
+    // Загружает файл в фоновом потоке и подменяет обе копии, не останавливая читателей:
+    // до подмены они видят старый словарь, после — новый целиком. Изменения,
+    // сделанные во время загрузки, теряются, как и при load(). Словарь должен
+    // жить, пока future не готов; при ошибке чтения содержимое не меняется.
+    std::future<bool> reloadAsync(const std::string& filename,
+                                  EnglishRussianDictionary::LoadMode mode = EnglishRussianDictionary::LoadMode::Copy);
+};
+
+template <typename Reader>
+auto ConcurrentDictionary::read(Reader reader) const
+    -> decltype(reader(std::declval<const EnglishRussianDictionary&>())) {
+    ReadGuard guard{ this, arrive() };
+    return reader(static_cast<const EnglishRussianDictionary&>(*instances[leftRight.load()]));
+}
+
+template <typename Writer>
+void ConcurrentDictionary::update(Writer writer) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    int current = leftRight.load();
+    writer(*instances[1 - current]);
+    publish(1 - current);
+    writer(*instances[current]);
+}
+
+#endif
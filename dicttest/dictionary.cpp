@@ -1,30 +1,180 @@
 ﻿#include "dictionary.h"
+#include "prefetch.h"
+#include "frozen_dictionary.h"
+#include "compressed_dictionary.h"
+#include "parallel_parser.h"
+#include "output_buffer.h"
+#include "edit_distance.h"
 #include <iostream>
 #include <fstream>
 #include <utility>
+#include <cstring>
+#include <algorithm>
+#include <functional>
 
-EnglishRussianDictionary::Node::Node(const char* eng, const char* rus)
-    : english(eng), russian(rus), left(nullptr), right(nullptr), parent(nullptr), isRed(true) {
+EnglishRussianDictionary::Node::Node(std::string_view eng, std::string_view rus)
+    : ownedEnglish(eng), russian(rus), keyPrefix(prefixOf(eng)), left(nullptr), right(nullptr),
+      parent(nullptr), subtreeSize(1), isRed(true), englishMapped(false), isMapped(false) {
 }
 
-EnglishRussianDictionary::Node::Node(const std::string& eng, const std::string& rus)
-    : english(eng), russian(rus), left(nullptr), right(nullptr), parent(nullptr), isRed(true) {
+EnglishRussianDictionary::Node::Node(std::string&& eng, std::string&& rus)
+    : ownedEnglish(std::move(eng)), russian(std::move(rus)), keyPrefix(prefixOf(ownedEnglish)), left(nullptr),
+      right(nullptr), parent(nullptr), subtreeSize(1), isRed(true), englishMapped(false), isMapped(false) {
 }
 
-EnglishRussianDictionary::EnglishRussianDictionary() : root(nullptr), size(0) {}
+EnglishRussianDictionary::Node::Node(Mapped, std::string_view eng, std::string_view rus)
+    : mappedEnglish(eng), mappedRussian(rus), keyPrefix(prefixOf(eng)), left(nullptr), right(nullptr),
+      parent(nullptr), subtreeSize(1), isRed(true), englishMapped(true), isMapped(true) {
+}
+
+EnglishRussianDictionary::Node::~Node() {
+    if (!englishMapped) ownedEnglish.~basic_string();
+    if (!isMapped) russian.~basic_string();
+}
+
+std::string_view EnglishRussianDictionary::Node::translation() const {
+    return isMapped ? mappedRussian : std::string_view(russian);
+}
+
+// Перевод из отображённого файла копируется при первом изменяющем доступе
+std::string& EnglishRussianDictionary::Node::translationRef() {
+    if (isMapped) {
+        std::string_view mapped = mappedRussian;
+        new (&russian) std::string(mapped);
+        isMapped = false;
+    }
+    return russian;
+}
+
+void EnglishRussianDictionary::Node::setTranslation(std::string_view rus) {
+    if (isMapped) {
+        new (&russian) std::string(rus);
+        isMapped = false;
+    }
+    else
+        russian.assign(rus.data(), rus.size());
+}
+
+void EnglishRussianDictionary::Node::setTranslation(std::string&& rus) {
+    if (isMapped) {
+        new (&russian) std::string(std::move(rus));
+        isMapped = false;
+    }
+    else
+        russian = std::move(rus);
+}
+
+EnglishRussianDictionary::EnglishRussianDictionary()
+    : root(nullptr), size(0), bloomRemovals(0), reversePending(nullptr) {}
+
+// Копия повторяет форму и цвета исходного дерева, поэтому строится за O(n)
+// без поворотов. Узлы, ссылающиеся на отображённый файл, разделяют его с оригиналом.
+EnglishRussianDictionary::EnglishRussianDictionary(const EnglishRussianDictionary& other)
+    : root(nullptr), size(0), mapping(other.mapping), bloomRemovals(0), reversePending(nullptr) {
+    root = clone(other.root, nullptr);
+    size = other.size;
+    enableHashIndex(other.hasHashIndex());
+    enableBloomFilter(other.hasBloomFilter());
+    enableReverseIndex(other.hasReverseIndex());
+}
+
+EnglishRussianDictionary& EnglishRussianDictionary::operator=(const EnglishRussianDictionary& other) {
+    if (this != &other) {
+        clear();
+        mapping = other.mapping;
+        root = clone(other.root, nullptr);
+        size = other.size;
+        hashIndex.reset();
+        enableHashIndex(other.hasHashIndex());
+        bloom.reset();
+        enableBloomFilter(other.hasBloomFilter());
+        reverseIndex.reset();
+        enableReverseIndex(other.hasReverseIndex());
+        reversedKeys.reset();
+    }
+    return *this;
+}
+
+EnglishRussianDictionary::EnglishRussianDictionary(EnglishRussianDictionary&& other) noexcept
+    : root(other.root), size(other.size), nodes(std::move(other.nodes)),
+      mapping(std::move(other.mapping)), hashIndex(std::move(other.hashIndex)),
+      bloom(std::move(other.bloom)), bloomRemovals(other.bloomRemovals),
+      reverseIndex(std::move(other.reverseIndex)), reversePending(other.reversePending),
+      reversedKeys(std::move(other.reversedKeys)) {
+    other.root = nullptr;
+    other.size = 0;
+    other.bloomRemovals = 0;
+    other.reversePending = nullptr;
+}
+
+EnglishRussianDictionary& EnglishRussianDictionary::operator=(EnglishRussianDictionary&& other) noexcept {
+    if (this != &other) {
+        clear(root);
+        root = other.root;
+        size = other.size;
+        nodes = std::move(other.nodes);
+        mapping = std::move(other.mapping);
+        hashIndex = std::move(other.hashIndex);
+        bloom = std::move(other.bloom);
+        bloomRemovals = other.bloomRemovals;
+        reverseIndex = std::move(other.reverseIndex);
+        reversePending = other.reversePending;
+        reversedKeys = std::move(other.reversedKeys);
+        other.root = nullptr;
+        other.size = 0;
+        other.bloomRemovals = 0;
+        other.reversePending = nullptr;
+    }
+    return *this;
+}
 
 EnglishRussianDictionary::~EnglishRussianDictionary() {
     clear(root);
 }
 
+// Вызывает только деструкторы узлов; память возвращается пулом целиком
 void EnglishRussianDictionary::clear(Node* node) {
     if (node) {
         clear(node->left);
         clear(node->right);
-        delete node;
+        node->~Node();
     }
 }
 
+EnglishRussianDictionary::Node* EnglishRussianDictionary::clone(const Node* node, Node* parent) {
+    if (!node) return nullptr;
+    Node* copy = node->isMapped
+        ? nodes.create(Node::Mapped{}, node->mappedEnglish, node->mappedRussian)
+        : nodes.create(node->english(), node->translation());
+    copy->isRed = node->isRed;
+    copy->subtreeSize = node->subtreeSize;
+    copy->parent = parent;
+    copy->left = clone(node->left, copy);
+    copy->right = clone(node->right, copy);
+    return copy;
+}
+
+void EnglishRussianDictionary::clear() {
+    clear(root);
+    nodes.release();
+    mapping.reset();
+    root = nullptr;
+    size = 0;
+    if (hashIndex) hashIndex->clear();
+    if (bloom) rebuildBloomFilter();
+    if (reverseIndex) reverseIndex->clear();
+    reversePending = nullptr;
+    if (reversedKeys) reversedKeys->clear();
+}
+
+size_t EnglishRussianDictionary::sizeOf(const Node* node) {
+    return node ? node->subtreeSize : 0;
+}
+
+void EnglishRussianDictionary::updateSize(Node* node) {
+    node->subtreeSize = static_cast<uint32_t>(1 + sizeOf(node->left) + sizeOf(node->right));
+}
+
 void EnglishRussianDictionary::rotateLeft(Node* node) {
     Node* rightChild = node->right;
     node->right = rightChild->left;
@@ -39,6 +189,8 @@ void EnglishRussianDictionary::rotateLeft(Node* node) {
         node->parent->right = rightChild;
     rightChild->left = node;
     node->parent = rightChild;
+    rightChild->subtreeSize = node->subtreeSize;
+    updateSize(node);
 }
 
 void EnglishRussianDictionary::rotateRight(Node* node) {
@@ -55,6 +207,8 @@ void EnglishRussianDictionary::rotateRight(Node* node) {
         node->parent->left = leftChild;
     leftChild->right = node;
     node->parent = leftChild;
+    leftChild->subtreeSize = node->subtreeSize;
+    updateSize(node);
 }
 
 void EnglishRussianDictionary::fixInsert(Node* node) {
@@ -71,12 +225,14 @@ void EnglishRussianDictionary::fixInsert(Node* node) {
                 if (node == node->parent->right) {
                     node = node->parent;
                     rotateLeft(node);
+                    DICTIONARY_METRIC(metricsCounters.countInsertRotation();)
                 }
                 if (node->parent) {
                     node->parent->isRed = false;
                     if (node->parent->parent) {
                         node->parent->parent->isRed = true;
                         rotateRight(node->parent->parent);
+                        DICTIONARY_METRIC(metricsCounters.countInsertRotation();)
                     }
                 }
             }
@@ -93,12 +249,14 @@ void EnglishRussianDictionary::fixInsert(Node* node) {
                 if (node == node->parent->left) {
                     node = node->parent;
                     rotateRight(node);
+                    DICTIONARY_METRIC(metricsCounters.countInsertRotation();)
                 }
                 if (node->parent) {
                     node->parent->isRed = false;
                     if (node->parent->parent) {
                         node->parent->parent->isRed = true;
                         rotateLeft(node->parent->parent);
+                        DICTIONARY_METRIC(metricsCounters.countInsertRotation();)
                     }
                 }
             }
@@ -125,65 +283,97 @@ EnglishRussianDictionary::Node* EnglishRussianDictionary::minimum(Node* node) co
     return node;
 }
 
-void EnglishRussianDictionary::fixDelete(Node* node) {
-    while (node != root && node && !node->isRed) {
-        if (node == node->parent->left) {
-            Node* sibling = node->parent->right;
-            if (sibling && sibling->isRed) {
+EnglishRussianDictionary::Node* EnglishRussianDictionary::maximum(Node* node) const {
+    if (!node) return nullptr;
+    while (node->right)
+        node = node->right;
+    return node;
+}
+
+EnglishRussianDictionary::Node* EnglishRussianDictionary::predecessor(Node* node) const {
+    if (node->left)
+        return maximum(node->left);
+    Node* parent = node->parent;
+    while (parent && node == parent->left) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+EnglishRussianDictionary::Node* EnglishRussianDictionary::successor(Node* node) const {
+    if (node->right)
+        return minimum(node->right);
+    Node* parent = node->parent;
+    while (parent && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+// node может быть nullptr (удалён чёрный лист), поэтому родитель передаётся отдельно
+void EnglishRussianDictionary::fixDelete(Node* node, Node* parent) {
+    while (node != root && (!node || !node->isRed)) {
+        if (node == parent->left) {
+            Node* sibling = parent->right;
+            if (sibling->isRed) {
                 sibling->isRed = false;
-                node->parent->isRed = true;
-                rotateLeft(node->parent);
-                sibling = node->parent->right;
+                parent->isRed = true;
+                rotateLeft(parent);
+                DICTIONARY_METRIC(metricsCounters.countDeleteRotation();)
+                sibling = parent->right;
             }
-            if (sibling &&
-                (!sibling->left || !sibling->left->isRed) &&
+            if ((!sibling->left || !sibling->left->isRed) &&
                 (!sibling->right || !sibling->right->isRed)) {
-                if (sibling) sibling->isRed = true;
-                node = node->parent;
+                sibling->isRed = true;
+                node = parent;
+                parent = node->parent;
             }
             else {
-                if (sibling && sibling->right && !sibling->right->isRed) {
-                    if (sibling->left) sibling->left->isRed = false;
+                if (!sibling->right || !sibling->right->isRed) {
+                    sibling->left->isRed = false;
                     sibling->isRed = true;
                     rotateRight(sibling);
-                    sibling = node->parent->right;
+                    DICTIONARY_METRIC(metricsCounters.countDeleteRotation();)
+                    sibling = parent->right;
                 }
-                if (sibling) {
-                    sibling->isRed = node->parent->isRed;
-                    if (sibling->right) sibling->right->isRed = false;
-                }
-                node->parent->isRed = false;
-                rotateLeft(node->parent);
+                sibling->isRed = parent->isRed;
+                parent->isRed = false;
+                if (sibling->right) sibling->right->isRed = false;
+                rotateLeft(parent);
+                DICTIONARY_METRIC(metricsCounters.countDeleteRotation();)
                 node = root;
             }
         }
         else {
-            Node* sibling = node->parent->left;
-            if (sibling && sibling->isRed) {
+            Node* sibling = parent->left;
+            if (sibling->isRed) {
                 sibling->isRed = false;
-                node->parent->isRed = true;
-                rotateRight(node->parent);
-                sibling = node->parent->left;
+                parent->isRed = true;
+                rotateRight(parent);
+                DICTIONARY_METRIC(metricsCounters.countDeleteRotation();)
+                sibling = parent->left;
             }
-            if (sibling &&
-                (!sibling->right || !sibling->right->isRed) &&
+            if ((!sibling->right || !sibling->right->isRed) &&
                 (!sibling->left || !sibling->left->isRed)) {
-                if (sibling) sibling->isRed = true;
-                node = node->parent;
+                sibling->isRed = true;
+                node = parent;
+                parent = node->parent;
             }
             else {
-                if (sibling && sibling->left && !sibling->left->isRed) {
-                    if (sibling->right) sibling->right->isRed = false;
+                if (!sibling->left || !sibling->left->isRed) {
+                    sibling->right->isRed = false;
                     sibling->isRed = true;
                     rotateLeft(sibling);
-                    sibling = node->parent->left;
-                }
-                if (sibling) {
-                    sibling->isRed = node->parent->isRed;
-                    if (sibling->left) sibling->left->isRed = false;
+                    DICTIONARY_METRIC(metricsCounters.countDeleteRotation();)
+                    sibling = parent->left;
                 }
-                node->parent->isRed = false;
-                rotateRight(node->parent);
+                sibling->isRed = parent->isRed;
+                parent->isRed = false;
+                if (sibling->left) sibling->left->isRed = false;
+                rotateRight(parent);
+                DICTIONARY_METRIC(metricsCounters.countDeleteRotation();)
                 node = root;
             }
         }
@@ -191,76 +381,270 @@ void EnglishRussianDictionary::fixDelete(Node* node) {
     if (node) node->isRed = false;
 }
 
-EnglishRussianDictionary::Node* EnglishRussianDictionary::find(Node* node, const std::string& key) const {
-    if (!node || node->english == key)
-        return node;
-    if (key < node->english)
-        return find(node->left, key);
-    return find(node->right, key);
+uint64_t EnglishRussianDictionary::prefixOf(std::string_view key) {
+    uint64_t prefix = 0;
+    size_t length = key.size() < 8 ? key.size() : 8;
+    for (size_t i = 0; i < length; ++i)
+        prefix |= static_cast<uint64_t>(static_cast<unsigned char>(key[i])) << (56 - 8 * i);
+    return prefix;
+}
+
+// Трёхзначное сравнение key с ключом узла; keyPrefix = prefixOf(key)
+int EnglishRussianDictionary::compareKey(std::string_view key, uint64_t keyPrefix, const Node* node) {
+#ifdef DICTIONARY_PLAIN_COMPARE
+    (void)keyPrefix;
+    return key.compare(node->english());
+#endif
+    if (keyPrefix != node->keyPrefix)
+        return keyPrefix < node->keyPrefix ? -1 : 1;
+    // Оба ключа не короче 8 байт — первые 8 уже равны
+    if (key.size() >= 8 && node->english().size() >= 8)
+        return key.substr(8).compare(node->english().substr(8));
+    return key.compare(node->english());
+}
+
+// Итеративный спуск с одним трёхзначным сравнением на уровень
+EnglishRussianDictionary::Node* EnglishRussianDictionary::findNode(std::string_view key) const {
+    if (bloom || hashIndex) {
+        uint64_t hash = hashKey(key);
+        if (bloom && !bloom->mayContain(hash))
+            return nullptr;
+        Node* found = hashIndex ? hashIndex->find(key, hash) : findInTree(key);
+        if (!found && bloom) bloom->recordFalsePositive(hash);
+        return found;
+    }
+    return findInTree(key);
+}
+
+EnglishRussianDictionary::Node* EnglishRussianDictionary::findInTree(std::string_view key) const {
+    uint64_t keyPrefix = prefixOf(key);
+    Node* node = root;
+    DICTIONARY_METRIC(uint64_t comparisons = 0;)
+    while (node) {
+        DICTIONARY_METRIC(comparisons++;)
+        int cmp = compareKey(key, keyPrefix, node);
+        if (cmp == 0)
+            break;
+        node = cmp < 0 ? node->left : node->right;
+    }
+    DICTIONARY_METRIC(metricsCounters.recordSearch(comparisons);)
+    return node;
 }
 
 EnglishRussianDictionary& EnglishRussianDictionary::operator+=(const std::pair<const char*, const char*>& words) {
-    return *this += std::make_pair(std::string(words.first), std::string(words.second));
+    insertOrAssign(words.first, words.second);
+    return *this;
 }
 
 EnglishRussianDictionary& EnglishRussianDictionary::operator+=(const std::pair<std::string, std::string>& words) {
+    insertOrAssign(words.first, words.second);
+    return *this;
+}
+
+EnglishRussianDictionary& EnglishRussianDictionary::operator+=(std::pair<std::string, std::string>&& words) {
+    insert_or_assign(std::move(words.first), std::move(words.second));
+    return *this;
+}
+
+// m отдельных операций стоят O(m log n), перестройка — O(n + m)
+bool EnglishRussianDictionary::preferPointUpdates(size_t size, size_t changes) {
+    size_t depth = 1;
+    for (size_t n = size; n > 1; n >>= 1)
+        depth++;
+    return changes * depth < size;
+}
+
+// Строит дерево заново из уже существующих узлов в порядке возрастания
+void EnglishRussianDictionary::relink(std::vector<Node*>& sorted) {
+    root = nullptr;
+    size = 0;
+    reversePending = nullptr;
+    bulkLoad(sorted);
+}
+
+EnglishRussianDictionary& EnglishRussianDictionary::operator+=(const EnglishRussianDictionary& overlay) {
+    if (&overlay == this) return *this;
+    if (preferPointUpdates(size, overlay.size)) {
+        overlay.forEach([this](std::string_view english, std::string_view russian) {
+            insertOrAssign(english, russian);
+        });
+        return *this;
+    }
+
+    std::vector<Node*> merged;
+    merged.reserve(size + overlay.size);
+    Node* mine = minimum(root);
+    Node* theirs = overlay.minimum(overlay.root);
+    while (mine || theirs) {
+        int order = !mine ? 1 : !theirs ? -1 : compareKey(mine->english(), mine->keyPrefix, theirs);
+        if (order < 0) {
+            merged.push_back(mine);
+            mine = successor(mine);
+        }
+        else if (order > 0) {
+            merged.push_back(nodes.create(theirs->english(), theirs->translation()));
+            theirs = overlay.successor(theirs);
+        }
+        else {
+            mine->setTranslation(theirs->translation());
+            merged.push_back(mine);
+            mine = successor(mine);
+            theirs = overlay.successor(theirs);
+        }
+    }
+    relink(merged);
+    return *this;
+}
+
+EnglishRussianDictionary& EnglishRussianDictionary::operator-=(const EnglishRussianDictionary& other) {
+    if (&other == this) {
+        clear();
+        return *this;
+    }
+    if (preferPointUpdates(size, other.size)) {
+        other.forEach([this](std::string_view english, std::string_view) { erase(findNode(english)); });
+        return *this;
+    }
+
+    // Узлы удаляются только после обхода: successor идёт через родителей
+    std::vector<Node*> kept;
+    std::vector<Node*> removed;
+    kept.reserve(size);
+    Node* mine = minimum(root);
+    Node* theirs = other.minimum(other.root);
+    while (mine) {
+        int order = !theirs ? -1 : compareKey(mine->english(), mine->keyPrefix, theirs);
+        if (order > 0) {
+            theirs = other.successor(theirs);
+            continue;
+        }
+        if (order < 0) {
+            kept.push_back(mine);
+        }
+        else {
+            removed.push_back(mine);
+            theirs = other.successor(theirs);
+        }
+        mine = successor(mine);
+    }
+    for (Node* node : removed)
+        nodes.destroy(node);
+    relink(kept);
+    return *this;
+}
+
+EnglishRussianDictionary::Diff EnglishRussianDictionary::diff(const EnglishRussianDictionary& other) const {
+    Diff result;
+    Node* mine = minimum(root);
+    Node* theirs = other.minimum(other.root);
+    while (mine || theirs) {
+        int order = !mine ? 1 : !theirs ? -1 : compareKey(mine->english(), mine->keyPrefix, theirs);
+        if (order < 0) {
+            result.removed.emplace_back(mine->english(), mine->translation());
+            mine = successor(mine);
+        }
+        else if (order > 0) {
+            result.added.emplace_back(theirs->english(), theirs->translation());
+            theirs = other.successor(theirs);
+        }
+        else {
+            if (mine->translation() != theirs->translation())
+                result.changed.push_back(Change{ mine->english(), mine->translation(), theirs->translation() });
+            mine = successor(mine);
+            theirs = other.successor(theirs);
+        }
+    }
+    return result;
+}
+
+void EnglishRussianDictionary::insertOrAssign(std::string_view english, std::string_view russian) {
     // Проверяем, существует ли уже такое слово
-    Node* existing = find(root, words.first);
+    Node* existing = findNode(english);
     if (existing) {
-        existing->russian = words.second;
-        return *this;
+        translationWillChange(existing);
+        existing->setTranslation(russian);
+        translationChanged(existing);
+        return;
     }
+    attach(nodes.create(english, russian));
+}
 
-    Node* newNode = new Node(words.first, words.second);
+void EnglishRussianDictionary::attach(Node* newNode) {
+    flushReversePending();
     Node* current = root;
     Node* parent = nullptr;
 
+    // Слова в дереве ещё нет, поэтому каждое поддерево на пути вырастет на один узел
+    bool goLeft = false;
     while (current) {
         parent = current;
-        if (newNode->english < current->english)
-            current = current->left;
-        else
-            current = current->right;
+        current->subtreeSize++;
+        goLeft = compareKey(newNode->english(), newNode->keyPrefix, current) < 0;
+        current = goLeft ? current->left : current->right;
     }
 
     newNode->parent = parent;
     if (!parent)
         root = newNode;
-    else if (newNode->english < parent->english)
+    else if (goLeft)
         parent->left = newNode;
     else
         parent->right = newNode;
 
     fixInsert(newNode);
     size++;
-    return *this;
+    if (hashIndex) hashIndex->insert(newNode);
+    if (reverseIndex) indexTranslation(newNode);
+    if (reversedKeys) reversedKeys->insert(reversedKeyOf(newNode));
+    if (bloom) {
+        // Переполненный фильтр теряет точность — перестраиваем с запасом
+        if (size > bloom->sizedFor())
+            rebuildBloomFilter();
+        else
+            bloom->add(hashKey(newNode->english()));
+    }
 }
 
 EnglishRussianDictionary& EnglishRussianDictionary::operator-=(const char* english) {
-    return *this -= std::string(english);
+    erase(findNode(english));
+    return *this;
 }
 
 EnglishRussianDictionary& EnglishRussianDictionary::operator-=(const std::string& english) {
-    Node* z = find(root, english);
-    if (!z) return *this;
+    erase(findNode(english));
+    return *this;
+}
+
+void EnglishRussianDictionary::erase(Node* z) {
+    if (!z) return;
+    flushReversePending();
+    if (hashIndex) hashIndex->erase(z);
+    if (reversedKeys) reversedKeys->erase(reversedKeyOf(z));
+    if (reverseIndex) reverseIndex->erase(z);
+    bool rebuildBloom = bloom && ++bloomRemovals > bloom->sizedFor() / 8 + 64;
 
     Node* y = z;
     Node* x;
+    Node* xParent;
     bool yOriginalColor = y->isRed;
 
     if (!z->left) {
         x = z->right;
+        xParent = z->parent;
         transplant(z, z->right);
     }
     else if (!z->right) {
         x = z->left;
+        xParent = z->parent;
         transplant(z, z->left);
     }
     else {
         y = minimum(z->right);
         yOriginalColor = y->isRed;
         x = y->right;
+        xParent = y;
         if (y->parent != z) {
+            xParent = y->parent;
             transplant(y, y->right);
             y->right = z->right;
             if (y->right) y->right->parent = y;
@@ -271,54 +655,969 @@ EnglishRussianDictionary& EnglishRussianDictionary::operator-=(const std::string
         y->isRed = z->isRed;
     }
 
-    delete z;
+    nodes.destroy(z);
     size--;
+    // Размеры меняются только на пути от места удаления до корня
+    for (Node* node = xParent; node; node = node->parent)
+        updateSize(node);
 
-    if (!yOriginalColor && x)
-        fixDelete(x);
-    return *this;
+    if (!yOriginalColor)
+        fixDelete(x, xParent);
+    if (rebuildBloom)
+        rebuildBloomFilter();
 }
 
 std::string EnglishRussianDictionary::operator[](const char* english) const {
-    return (*this)[std::string(english)];
+    DICTIONARY_METRIC(MetricsCounters::LookupTimer timer(metricsCounters);)
+    Node* node = findNode(english);
+    if (!node) return "";
+    return std::string(node->translation());
 }
 
 std::string EnglishRussianDictionary::operator[](const std::string& english) const {
-    Node* node = find(root, english);
+    DICTIONARY_METRIC(MetricsCounters::LookupTimer timer(metricsCounters);)
+    Node* node = findNode(english);
     if (!node) return "";
-    return node->russian;
+    return std::string(node->translation());
 }
 
 std::string& EnglishRussianDictionary::operator[](const char* english) {
-    return (*this)[std::string(english)];
+    return translationFor(english);
 }
 
 std::string& EnglishRussianDictionary::operator[](const std::string& english) {
-    Node* node = find(root, english);
+    return translationFor(english);
+}
+
+std::string& EnglishRussianDictionary::translationFor(std::string_view english) {
+    flushReversePending();
+    Node* node = findNode(english);
     if (!node) {
-        *this += std::make_pair(english, "");
-        node = find(root, english);
+        node = nodes.create(english, std::string_view());
+        attach(node);
+    }
+    if (reverseIndex) {
+        translationWillChange(node);
+        reversePending = node;
+    }
+    return node->translationRef();
+}
+
+std::optional<std::string_view> EnglishRussianDictionary::find(std::string_view english) const {
+    DICTIONARY_METRIC(MetricsCounters::LookupTimer timer(metricsCounters);)
+    const Node* node = findNode(english);
+    if (!node) return std::nullopt;
+    return node->translation();
+}
+
+bool EnglishRussianDictionary::contains(std::string_view english) const {
+    DICTIONARY_METRIC(MetricsCounters::LookupTimer timer(metricsCounters);)
+    return findNode(english) != nullptr;
+}
+
+EnglishRussianDictionary::const_iterator EnglishRussianDictionary::begin() const {
+    return const_iterator(this, minimum(root));
+}
+
+EnglishRussianDictionary::const_iterator EnglishRussianDictionary::end() const {
+    return const_iterator(this, nullptr);
+}
+
+EnglishRussianDictionary::const_iterator EnglishRussianDictionary::lower_bound(std::string_view english) const {
+    uint64_t keyPrefix = prefixOf(english);
+    Node* node = root;
+    Node* result = nullptr;
+    while (node) {
+        if (compareKey(english, keyPrefix, node) > 0) {
+            node = node->right;
+        }
+        else {
+            result = node;
+            node = node->left;
+        }
+    }
+    return const_iterator(this, result);
+}
+
+EnglishRussianDictionary::const_iterator EnglishRussianDictionary::upper_bound(std::string_view english) const {
+    uint64_t keyPrefix = prefixOf(english);
+    Node* node = root;
+    Node* result = nullptr;
+    while (node) {
+        if (compareKey(english, keyPrefix, node) < 0) {
+            result = node;
+            node = node->left;
+        }
+        else {
+            node = node->right;
+        }
+    }
+    return const_iterator(this, result);
+}
+
+std::pair<EnglishRussianDictionary::const_iterator, EnglishRussianDictionary::const_iterator>
+EnglishRussianDictionary::equal_range(std::string_view english) const {
+    const_iterator first = lower_bound(english);
+    const_iterator last = first;
+    if (last != end() && last.english() == english)
+        ++last;
+    return std::make_pair(first, last);
+}
+
+// Конец диапазона — первое слово, чьё начало длины prefix.size() больше prefix;
+// условие монотонно по порядку ключей, поэтому хватает одного спуска
+EnglishRussianDictionary::Range EnglishRussianDictionary::prefix(std::string_view prefix) const {
+    Node* node = root;
+    Node* last = nullptr;
+    while (node) {
+        if (node->english().substr(0, prefix.size()) > prefix) {
+            last = node;
+            node = node->left;
+        }
+        else {
+            node = node->right;
+        }
+    }
+    return Range(lower_bound(prefix), const_iterator(this, last));
+}
+
+size_t EnglishRussianDictionary::rank(std::string_view english) const {
+    uint64_t keyPrefix = prefixOf(english);
+    size_t less = 0;
+    for (Node* node = root; node;) {
+        if (compareKey(english, keyPrefix, node) > 0) {
+            less += sizeOf(node->left) + 1;
+            node = node->right;
+        }
+        else {
+            node = node->left;
+        }
+    }
+    return less;
+}
+
+EnglishRussianDictionary::const_iterator EnglishRussianDictionary::select(size_t index) const {
+    Node* node = root;
+    while (node) {
+        size_t leftSize = sizeOf(node->left);
+        if (index < leftSize) {
+            node = node->left;
+        }
+        else if (index == leftSize) {
+            break;
+        }
+        else {
+            index -= leftSize + 1;
+            node = node->right;
+        }
+    }
+    return const_iterator(this, node);
+}
+
+size_t EnglishRussianDictionary::countRange(std::string_view from, std::string_view to) const {
+    if (!(from < to)) return 0;
+    return rank(to) - rank(from);
+}
+
+void EnglishRussianDictionary::enableHashIndex(bool enable) {
+    if (!enable) {
+        hashIndex.reset();
+        return;
+    }
+    if (!hashIndex) {
+        hashIndex.reset(new HashIndex<Node, NodeKey>());
+        rebuildHashIndex();
+    }
+}
+
+bool EnglishRussianDictionary::hasHashIndex() const {
+    return hashIndex != nullptr;
+}
+
+void EnglishRussianDictionary::rebuildHashIndex() {
+    hashIndex->clear();
+    hashIndex->reserve(size);
+    for (Node* node = minimum(root); node; node = successor(node))
+        hashIndex->insert(node);
+}
+
+void EnglishRussianDictionary::enableReverseIndex(bool enable) {
+    if (!enable) {
+        reverseIndex.reset();
+        reversePending = nullptr;
+        return;
     }
-    return node->russian;
+    if (!reverseIndex) {
+        reverseIndex.reset(new HashIndex<Node, NodeTranslation>());
+        rebuildReverseIndex();
+    }
+}
+
+bool EnglishRussianDictionary::hasReverseIndex() const {
+    return reverseIndex != nullptr;
+}
+
+void EnglishRussianDictionary::rebuildReverseIndex() {
+    reverseIndex->clear();
+    reverseIndex->reserve(size);
+    for (Node* node = minimum(root); node; node = successor(node))
+        indexTranslation(node);
+    reversePending = nullptr;
+}
+
+void EnglishRussianDictionary::indexTranslation(Node* node) {
+    reverseIndex->insert(node, hashKey(node->translation()));
+}
+
+// Запись ищется по хешу текущего перевода, поэтому вынимается до его замены
+void EnglishRussianDictionary::translationWillChange(Node* node) {
+    if (!reverseIndex) return;
+    flushReversePending();
+    reverseIndex->erase(node);
+}
+
+void EnglishRussianDictionary::translationChanged(Node* node) {
+    if (reverseIndex) indexTranslation(node);
+}
+
+void EnglishRussianDictionary::flushReversePending() {
+    if (!reversePending) return;
+    Node* node = reversePending;
+    reversePending = nullptr;
+    indexTranslation(node);
+}
+
+// Узла из reversePending в индексе нет, поэтому он проверяется отдельно
+std::vector<std::string_view> EnglishRussianDictionary::findEnglish(std::string_view russian) const {
+    std::vector<std::string_view> words;
+    if (!reverseIndex) {
+        forEach([&](std::string_view english, std::string_view translation) {
+            if (translation == russian) words.push_back(english);
+        });
+        return words;
+    }
+    reverseIndex->forEachEqual(russian, hashKey(russian), [&](const Node* node) {
+        words.push_back(node->english());
+    });
+    if (reversePending && reversePending->translation() == russian)
+        words.push_back(reversePending->english());
+    std::sort(words.begin(), words.end());
+    return words;
+}
+
+void EnglishRussianDictionary::enableBloomFilter(bool enable) {
+    if (!enable) {
+        bloom.reset();
+        return;
+    }
+    if (!bloom) {
+        bloom.reset(new BloomFilter());
+        rebuildBloomFilter();
+    }
+}
+
+bool EnglishRussianDictionary::hasBloomFilter() const {
+    return bloom != nullptr;
+}
+
+BloomFilter::Stats EnglishRussianDictionary::bloomStats() const {
+    if (!bloom) return BloomFilter::Stats();
+    return bloom->stats();
+}
+
+void EnglishRussianDictionary::rebuildBloomFilter() {
+    // Размер с двукратным запасом, чтобы перестройки при росте были редкими
+    bloom->reset(2 * size + 64);
+    for (Node* node = minimum(root); node; node = successor(node))
+        bloom->add(hashKey(node->english()));
+    bloomRemovals = 0;
+}
+
+// Ключи спускаются по дереву группами: за один проход каждый курсор делает шаг
+// на уровень вниз и запрашивает следующий узел, поэтому промахи кэша разных
+// ключей перекрываются, а не ждут друг друга.
+void EnglishRussianDictionary::lookupBatch(const std::string_view* keys, size_t n,
+                                           std::optional<std::string_view>* results) const {
+    const size_t group = 16;
+    if (hashIndex) {
+        // С индексом каждый ключ — одна проба; хеши считаются заранее,
+        // чтобы успеть запросить нужные группы таблицы
+        uint64_t hashes[group];
+        for (size_t start = 0; start < n; start += group) {
+            size_t count = std::min(group, n - start);
+            for (size_t i = 0; i < count; ++i) {
+                hashes[i] = hashKey(keys[start + i]);
+                hashIndex->prefetch(hashes[i]);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const Node* node = hashIndex->find(keys[start + i], hashes[i]);
+                if (node)
+                    results[start + i] = node->translation();
+                else
+                    results[start + i] = std::nullopt;
+            }
+        }
+        return;
+    }
+
+    const Node* cursor[group];
+    size_t pending[group];
+    uint64_t prefixes[group];
+
+    for (size_t start = 0; start < n; start += group) {
+        size_t active = std::min(group, n - start);
+        for (size_t i = 0; i < active; ++i) {
+            cursor[i] = root;
+            pending[i] = start + i;
+            prefixes[i] = prefixOf(keys[start + i]);
+        }
+        if (root) prefetchRead(root);
+
+        while (active) {
+            for (size_t i = 0; i < active;) {
+                const Node* node = cursor[i];
+                size_t index = pending[i];
+                int cmp = node ? compareKey(keys[index], prefixes[i], node) : 0;
+                if (cmp == 0) {
+                    if (node)
+                        results[index] = node->translation();
+                    else
+                        results[index] = std::nullopt;
+                    // Завершённый курсор заменяется последним активным
+                    active--;
+                    cursor[i] = cursor[active];
+                    pending[i] = pending[active];
+                    prefixes[i] = prefixes[active];
+                    continue;
+                }
+                node = cmp < 0 ? node->left : node->right;
+                if (node) prefetchRead(node);
+                cursor[i] = node;
+                ++i;
+            }
+        }
+    }
+}
+
+std::vector<std::optional<std::string_view>> EnglishRussianDictionary::lookupBatch(
+    const std::vector<std::string_view>& keys) const {
+    std::vector<std::optional<std::string_view>> results(keys.size());
+    lookupBatch(keys.data(), keys.size(), results.data());
+    return results;
 }
 
 size_t EnglishRussianDictionary::count() const {
     return size;
 }
 
-bool EnglishRussianDictionary::load(const std::string& filename) {
+size_t EnglishRussianDictionary::memoryUsage() const {
+    // Короткие строки хранятся внутри объекта std::string и отдельной памяти не занимают
+    auto heapBytes = [](const std::string& text) -> size_t {
+        const char* object = reinterpret_cast<const char*>(&text);
+        std::less<const char*> before;
+        bool embedded = !before(text.data(), object) && before(text.data(), object + sizeof(text));
+        return embedded ? 0 : text.capacity() + 1;
+    };
+    size_t bytes = nodes.memoryUsage();
+    for (Node* node = minimum(root); node; node = successor(node))
+        bytes += (node->englishMapped ? 0 : heapBytes(node->ownedEnglish)) +
+                 (node->isMapped ? 0 : heapBytes(node->russian));
+    if (hashIndex) bytes += hashIndex->memoryUsage();
+    if (bloom) bytes += bloom->stats().bytes;
+    if (reverseIndex) bytes += reverseIndex->memoryUsage();
+    {
+        // Узел std::set: цвет, три указателя и значение
+        std::lock_guard<std::mutex> lock(reversedKeysMutex);
+        if (reversedKeys) bytes += reversedKeys->size() * (4 * sizeof(void*) + sizeof(ReversedKey));
+    }
+    return bytes;
+}
+
+DictionaryMetrics EnglishRussianDictionary::metrics() const {
+    DictionaryMetrics result = DictionaryMetrics();
+#ifdef DICTIONARY_METRICS
+    result.counting = true;
+    metricsCounters.collect(result);
+#endif
+    result.nodes = size;
+    result.height = subtreeHeight(root);
+    // Путь по левым детям: у красно-черного дерева чёрная высота у всех путей одна
+    for (const Node* node = root; node; node = node->left)
+        if (!node->isRed) result.blackHeight++;
+    result.nodeBytes = nodes.memoryUsage();
+    result.memoryBytes = memoryUsage();
+    return result;
+}
+
+void EnglishRussianDictionary::resetMetrics() {
+    DICTIONARY_METRIC(metricsCounters.reset();)
+}
+
+int EnglishRussianDictionary::subtreeHeight(const Node* node) {
+    if (!node) return 0;
+    return 1 + std::max(subtreeHeight(node->left), subtreeHeight(node->right));
+}
+
+bool EnglishRussianDictionary::load(const std::string& filename, LoadMode mode) {
+    if (mode == LoadMode::Mapped)
+        return loadMapped(filename);
+
     std::ifstream file(filename);
     if (!file.is_open()) return false;
 
-    clear(root);
-    root = nullptr;
-    size = 0;
+    clear();
 
+    std::vector<Node*> pending;
     std::string eng, rus;
     while (std::getline(file, eng) && std::getline(file, rus)) {
-        *this += std::make_pair(eng, rus);
+        pending.push_back(nodes.create(std::move(eng), std::move(rus)));
     }
+    bulkLoad(pending);
 
     file.close();
     return true;
-}
\ No newline at end of file
+}
+
+// Разбор строк повторяет std::getline: строка заканчивается '\n' или концом файла,
+// пустой хвост после последнего '\n' строкой не считается
+bool EnglishRussianDictionary::loadMapped(const std::string& filename) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(filename)) return false;
+
+    clear();
+    mapping = file;
+
+    const char* pos = file->data();
+    const char* end = pos + file->size();
+    auto nextLine = [&](std::string_view& line) {
+        if (pos >= end) return false;
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* lineEnd = newline ? newline : end;
+        line = std::string_view(pos, lineEnd - pos);
+        pos = newline ? newline + 1 : end;
+        return true;
+    };
+
+    std::vector<Node*> pending;
+    std::string_view eng, rus;
+    while (nextLine(eng) && nextLine(rus)) {
+        pending.push_back(nodes.create(Node::Mapped{}, eng, rus));
+    }
+    bulkLoad(pending);
+    return true;
+}
+
+bool EnglishRussianDictionary::loadParallel(const std::string& filename, unsigned threads, LoadMode mode) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(filename)) return false;
+
+    clear();
+    std::vector<std::pair<std::string_view, std::string_view>> words =
+        parseSortedPairs(file->data(), file->size(), threads);
+
+    // Слова уже отсортированы и без повторов, bulkLoad только строит дерево
+    std::vector<Node*> pending;
+    pending.reserve(words.size());
+    if (mode == LoadMode::Mapped) {
+        mapping = file;
+        for (const auto& word : words)
+            pending.push_back(nodes.create(Node::Mapped{}, word.first, word.second));
+    }
+    else {
+        for (const auto& word : words)
+            pending.push_back(nodes.create(word.first, word.second));
+    }
+    bulkLoad(pending);
+    return true;
+}
+
+namespace {
+
+const char binaryMagic[8] = { 'E', 'R', 'D', 'B', 'I', 'N', '1', '\0' };
+
+// Сбрасывает буфер и сам поток: ошибка записи хвоста (например, нет места)
+// видна только после flush и close
+bool finishFile(OutputBuffer& out, std::ofstream& file) {
+    bool written = out.flush();
+    file.flush();
+    file.close();
+    return written && !file.fail();
+}
+
+}
+
+bool EnglishRussianDictionary::save(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    OutputBuffer out(file);
+    for (Node* node = minimum(root); node; node = successor(node)) {
+        out.write(node->english());
+        out.put('\n');
+        out.write(node->translation());
+        out.put('\n');
+    }
+    return finishFile(out, file);
+}
+
+bool EnglishRussianDictionary::saveBinary(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    OutputBuffer out(file);
+    uint64_t total = size;
+    out.write(binaryMagic, sizeof(binaryMagic));
+    out.write(&total, sizeof(total));
+    for (Node* node = minimum(root); node; node = successor(node)) {
+        std::string_view russian = node->translation();
+        uint32_t lengths[2] = { static_cast<uint32_t>(node->english().size()), static_cast<uint32_t>(russian.size()) };
+        out.write(lengths, sizeof(lengths));
+        out.write(node->english());
+        out.write(russian);
+    }
+    return finishFile(out, file);
+}
+
+// Файл сначала проверяется целиком: повреждённый или обрезанный файл
+// оставляет словарь как был
+bool EnglishRussianDictionary::loadBinary(const std::string& filename, LoadMode mode) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(filename)) return false;
+
+    const char* begin = file->data();
+    const char* end = begin + file->size();
+    uint64_t total = 0;
+    if (file->size() < sizeof(binaryMagic) + sizeof(total) ||
+        std::memcmp(begin, binaryMagic, sizeof(binaryMagic)) != 0)
+        return false;
+    std::memcpy(&total, begin + sizeof(binaryMagic), sizeof(total));
+    begin += sizeof(binaryMagic) + sizeof(total);
+
+    uint64_t records = 0;
+    for (const char* pos = begin; records < total; ++records) {
+        uint32_t lengths[2];
+        if (size_t(end - pos) < sizeof(lengths)) break;
+        std::memcpy(lengths, pos, sizeof(lengths));
+        pos += sizeof(lengths);
+        if (size_t(end - pos) < size_t(lengths[0]) + lengths[1]) break;
+        pos += size_t(lengths[0]) + lengths[1];
+    }
+    if (records != total) return false;
+
+    clear();
+    std::vector<Node*> pending;
+    pending.reserve(static_cast<size_t>(total));
+    for (const char* pos = begin; pending.size() < total;) {
+        uint32_t lengths[2];
+        std::memcpy(lengths, pos, sizeof(lengths));
+        pos += sizeof(lengths);
+        std::string_view english(pos, lengths[0]);
+        std::string_view russian(pos + lengths[0], lengths[1]);
+        pos += size_t(lengths[0]) + lengths[1];
+        pending.push_back(mode == LoadMode::Mapped ? nodes.create(Node::Mapped{}, english, russian)
+                                                   : nodes.create(english, russian));
+    }
+
+    if (mode == LoadMode::Mapped)
+        mapping = file;
+    bulkLoad(pending);
+    return true;
+}
+
+void EnglishRussianDictionary::assign(const std::vector<std::pair<std::string, std::string>>& words) {
+    clear();
+    std::vector<Node*> pending;
+    pending.reserve(words.size());
+    for (const auto& word : words)
+        pending.push_back(nodes.create(word.first, word.second));
+    bulkLoad(pending);
+}
+
+// Строит дерево за O(n) из узлов в порядке поступления (дерево должно быть пустым).
+// Неотсортированный вход сортируется устойчиво; из повторов остаётся последний,
+// как при последовательных operator+=.
+void EnglishRussianDictionary::bulkLoad(std::vector<Node*>& pending) {
+    auto less = [](const Node* a, const Node* b) { return compareKey(a->english(), a->keyPrefix, b) < 0; };
+
+    bool sorted = true;
+    for (size_t i = 1; i < pending.size() && sorted; ++i)
+        sorted = less(pending[i - 1], pending[i]);
+
+    if (!sorted) {
+        std::stable_sort(pending.begin(), pending.end(), less);
+        size_t out = 0;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (i + 1 < pending.size() && pending[i]->english() == pending[i + 1]->english())
+                nodes.destroy(pending[i]);
+            else
+                pending[out++] = pending[i];
+        }
+        pending.resize(out);
+    }
+
+    size = pending.size();
+    root = nullptr;
+    if (!pending.empty()) {
+        // Дерево, построенное делением пополам, заполнено до глубины floor(log2 n);
+        // красным красится только самый нижний уровень, чёрная высота везде одинакова
+        int redDepth = 0;
+        for (size_t n = pending.size(); n > 1; n >>= 1)
+            redDepth++;
+        root = buildBalanced(pending, 0, pending.size(), 0, redDepth, nullptr);
+        root->isRed = false;
+    }
+    // Индексы перестраиваются и для пустого словаря: после relink в них
+    // остались бы уже удалённые узлы
+    if (hashIndex) rebuildHashIndex();
+    if (bloom) rebuildBloomFilter();
+    if (reverseIndex) rebuildReverseIndex();
+    if (reversedKeys) rebuildReversedKeys();
+}
+
+EnglishRussianDictionary::Node* EnglishRussianDictionary::buildBalanced(
+    const std::vector<Node*>& sorted, size_t lo, size_t hi, int depth, int redDepth, Node* parent) {
+    if (lo >= hi) return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    Node* node = sorted[mid];
+    node->parent = parent;
+    node->isRed = depth == redDepth;
+    node->left = buildBalanced(sorted, lo, mid, depth + 1, redDepth, node);
+    node->right = buildBalanced(sorted, mid + 1, hi, depth + 1, redDepth, node);
+    node->subtreeSize = static_cast<uint32_t>(hi - lo);
+    return node;
+}
+
+FrozenDictionary EnglishRussianDictionary::freeze() const {
+    std::vector<std::pair<std::string_view, std::string_view>> sorted;
+    sorted.reserve(size);
+    forEach([&](std::string_view english, std::string_view russian) {
+        sorted.emplace_back(english, russian);
+    });
+    return FrozenDictionary(sorted);
+}
+
+// Первое слово не меньше key при условии, что node->english() < key. Поиск идёт
+// от node вверх до предка, за которым начинается ответ, и затем вниз, поэтому
+// стоит O(log расстояния), а не O(log n): при обходе подряд цель обычно рядом.
+EnglishRussianDictionary::Node* EnglishRussianDictionary::lowerBoundFrom(Node* node, std::string_view key) const {
+    uint64_t keyPrefix = prefixOf(key);
+    while (node->parent) {
+        Node* parent = node->parent;
+        if (node == parent->left && compareKey(key, keyPrefix, parent) <= 0) break;
+        node = parent;
+    }
+    Node* candidate = node->parent;
+    for (Node* current = node->right; current;) {
+        if (compareKey(key, keyPrefix, current) <= 0) {
+            candidate = current;
+            current = current->left;
+        }
+        else {
+            current = current->right;
+        }
+    }
+    return candidate;
+}
+
+// Обход слов словаря по возрастанию
+struct EnglishRussianDictionary::TreeCursor {
+    const EnglishRussianDictionary* dict;
+    Node* node;
+
+    explicit TreeCursor(const EnglishRussianDictionary* owner) : dict(owner), node(owner->minimum(owner->root)) {}
+    bool alphabetical() const { return true; }
+    bool valid() const { return node != nullptr; }
+    std::string_view key() const { return node->english(); }
+    const Node* current() const { return node; }
+    void next() { node = dict->successor(node); }
+    // Первое слово не меньше target; target больше текущего слова
+    void seek(std::string_view target) { node = dict->lowerBoundFrom(node, target); }
+};
+
+namespace {
+
+// Трёхзначное сравнение слова word, прочитанного с конца, со строкой reversed
+int compareFromEnd(std::string_view word, std::string_view reversed) {
+    size_t length = std::min(word.size(), reversed.size());
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char a = static_cast<unsigned char>(word[word.size() - 1 - i]);
+        unsigned char b = static_cast<unsigned char>(reversed[i]);
+        if (a != b) return a < b ? -1 : 1;
+    }
+    return word.size() < reversed.size() ? -1 : word.size() > reversed.size() ? 1 : 0;
+}
+
+}
+
+EnglishRussianDictionary::ReversedKey EnglishRussianDictionary::reversedKeyOf(const Node* node) {
+    std::string_view english = node->english();
+    uint64_t suffix = 0;
+    size_t length = english.size() < 8 ? english.size() : 8;
+    for (size_t i = 0; i < length; ++i)
+        suffix |= static_cast<uint64_t>(static_cast<unsigned char>(english[english.size() - 1 - i])) << (56 - 8 * i);
+    return ReversedKey{ suffix, node };
+}
+
+// Узел читается, только когда последние 8 байт совпали
+bool EnglishRussianDictionary::ReversedLess::operator()(const ReversedKey& a, const ReversedKey& b) const {
+    if (a.suffix != b.suffix) return a.suffix < b.suffix;
+    std::string_view left = a.node->english(), right = b.node->english();
+    size_t length = std::min(left.size(), right.size());
+    for (size_t i = 1; i <= length; ++i) {
+        unsigned char x = static_cast<unsigned char>(left[left.size() - i]);
+        unsigned char y = static_cast<unsigned char>(right[right.size() - i]);
+        if (x != y) return x < y;
+    }
+    return left.size() < right.size();
+}
+
+bool EnglishRussianDictionary::ReversedLess::operator()(const ReversedKey& a, const ReversedTarget& b) const {
+    if (a.suffix != b.suffix) return a.suffix < b.suffix;
+    return compareFromEnd(a.node->english(), b.reversed) < 0;
+}
+
+bool EnglishRussianDictionary::ReversedLess::operator()(const ReversedTarget& a, const ReversedKey& b) const {
+    if (a.suffix != b.suffix) return a.suffix < b.suffix;
+    return compareFromEnd(b.node->english(), a.reversed) > 0;
+}
+
+// Обход слов в порядке прочтения с конца; ключ — слово задом наперёд
+struct EnglishRussianDictionary::ReversedCursor {
+    const ReversedKeys* keys;
+    ReversedKeys::const_iterator position;
+    std::string reversed;
+
+    explicit ReversedCursor(const ReversedKeys& index) : keys(&index), position(index.begin()) { load(); }
+    bool alphabetical() const { return false; }
+    bool valid() const { return position != keys->end(); }
+    std::string_view key() const { return reversed; }
+    const Node* current() const { return position->node; }
+    void next() {
+        ++position;
+        load();
+    }
+    void seek(std::string_view target) {
+        position = keys->lower_bound(ReversedTarget{ prefixOf(target), target });
+        load();
+    }
+    void load() {
+        if (!valid()) return;
+        std::string_view english = position->node->english();
+        reversed.assign(english.rbegin(), english.rend());
+    }
+};
+
+// Первый обратный поиск строит порядок под блокировкой; дальше его правят
+// только изменения словаря, которые с поиском одновременно не идут
+const EnglishRussianDictionary::ReversedKeys& EnglishRussianDictionary::reversedKeyIndex() const {
+    std::lock_guard<std::mutex> lock(reversedKeysMutex);
+    if (!reversedKeys) {
+        reversedKeys.reset(new ReversedKeys());
+        rebuildReversedKeys();
+    }
+    return *reversedKeys;
+}
+
+void EnglishRussianDictionary::rebuildReversedKeys() const {
+    std::vector<ReversedKey> keys;
+    keys.reserve(size);
+    for (Node* node = minimum(root); node; node = successor(node))
+        keys.push_back(reversedKeyOf(node));
+    // Отсортированные ключи вставляются с подсказкой end() за амортизированное O(1)
+    std::sort(keys.begin(), keys.end(), ReversedLess());
+    reversedKeys->clear();
+    for (const ReversedKey& key : keys)
+        reversedKeys->insert(reversedKeys->end(), key);
+}
+
+// best — не более limit лучших слов, упорядоченных по (расстояние, слово).
+// Когда набрано limit слов, граница сужается. Если это первый проход и он идёт
+// по алфавиту, равное расстояние уже не поможет, потому что следующие слова
+// больше; в остальных проходах равное расстояние ещё может вытеснить слово побольше.
+//
+// Если префикс key[0..depth] не подходит, следующее слово ищется не простым
+// пропуском диапазона, а сразу с наименьшего подходящего символа на этой глубине
+// (или выше, если на этой символы кончились) — так на каждый отсечённый узел
+// бора приходится один переход, а не по одному на каждого его соседа.
+//
+// Кроме того, префикс подходит, только если у него уже есть начало не дальше
+// prefix.errors от начала образца длины prefix.length или такое начало ещё может
+// появиться; satisfied[depth] отмечает, что оно уже есть.
+template <typename Matcher, typename Cursor>
+void EnglishRussianDictionary::collectSuggestions(const Matcher& matcher, PrefixLimit prefix, Cursor cursor,
+                                                  size_t maxDistance, size_t limit,
+                                                  std::vector<Suggestion>& best) const {
+    std::vector<typename Matcher::State> columns(1, matcher.initial());
+    std::vector<char> satisfied(1, prefix.errors >= prefix.length);
+    typename Matcher::State scratch = matcher.initial();
+    // Слово, для префиксов которого посчитаны столбцы; копия, потому что ключ
+    // курсора может жить в его буфере
+    std::string path;
+    std::string target;
+    const bool ordered = best.empty() && cursor.alphabetical();
+    auto bound = [&]() -> size_t {
+        if (best.size() < limit) return maxDistance;
+        return ordered ? best.back().distance - 1 : best.back().distance;
+    };
+    // Проверяет новый столбец; done — есть ли уже подходящее начало
+    auto viable = [&](const typename Matcher::State& column, char& done) {
+        if (matcher.lowerBound(column) > bound()) return false;
+        if (done) return true;
+        if (matcher.distance(column, prefix.length) <= prefix.errors)
+            done = 1;
+        else if (matcher.lowerBound(column, prefix.length) > prefix.errors)
+            return false;
+        return true;
+    };
+    auto accepts = [&](size_t depth, unsigned char c) {
+        matcher.advance(columns[depth], c, scratch);
+        char done = satisfied[depth];
+        return viable(scratch, done);
+    };
+    // Наименьший символ больше after, с которым префикс длины depth остаётся подходящим.
+    // Символ из образца сдвигает столбцы не хуже любого другого, поэтому если подходит
+    // символ не из образца, подходят все.
+    auto nextSymbol = [&](size_t depth, unsigned char after) -> int {
+        if (matcher.other() >= 0 && accepts(depth, static_cast<unsigned char>(matcher.other())))
+            return after < 255 ? after + 1 : -1;
+        for (unsigned char c : matcher.symbols()) {
+            if (c > after && accepts(depth, c))
+                return c;
+        }
+        return -1;
+    };
+    auto better = [](const Suggestion& a, const Suggestion& b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.english < b.english;
+    };
+
+    while (cursor.valid() && !(best.size() == limit && best.back().distance == 0)) {
+        std::string_view key = cursor.key();
+        size_t valid = 0;
+        size_t common = std::min(path.size(), key.size());
+        while (valid < common && path[valid] == key[valid])
+            valid++;
+        path.assign(key);
+
+        // Длина неподходящего префикса. Граница могла сузиться с прошлых слов,
+        // поэтому проверяется и уже посчитанная часть.
+        size_t failed = 0;
+        if (valid > 0 && matcher.lowerBound(columns[valid]) > bound())
+            failed = valid;
+        for (size_t depth = valid; depth < key.size() && !failed; ++depth) {
+            if (columns.size() <= depth + 1) {
+                columns.emplace_back();
+                satisfied.push_back(0);
+            }
+            matcher.advance(columns[depth], static_cast<unsigned char>(key[depth]), columns[depth + 1]);
+            satisfied[depth + 1] = satisfied[depth];
+            if (!viable(columns[depth + 1], satisfied[depth + 1]))
+                failed = depth + 1;
+        }
+
+        if (failed) {
+            size_t depth = failed - 1;
+            int next = nextSymbol(depth, static_cast<unsigned char>(key[depth]));
+            while (next < 0 && depth > 0) {
+                depth--;
+                next = nextSymbol(depth, static_cast<unsigned char>(key[depth]));
+            }
+            if (next < 0) break;
+            target.assign(key.substr(0, depth));
+            target.push_back(static_cast<char>(next));
+            path.resize(depth);
+            cursor.seek(target);
+            continue;
+        }
+
+        size_t distance = matcher.distance(columns[key.size()]);
+        const Node* node = cursor.current();
+        if (distance <= bound()) {
+            Suggestion suggestion{ node->english(), node->translation(), distance };
+            bool known = std::any_of(best.begin(), best.end(), [node](const Suggestion& found) {
+                return found.english.data() == node->english().data();
+            });
+            if (!known) {
+                best.insert(std::upper_bound(best.begin(), best.end(), suggestion, better), suggestion);
+                if (best.size() > limit)
+                    best.pop_back();
+            }
+        }
+        cursor.next();
+    }
+}
+
+// Если слово не дальше maxDistance от образца q = q1 q2, то по выравниванию оно
+// делится на w1 w2 с ed(q1, w1) + ed(q2, w2) <= maxDistance. Значит, либо
+// ed(q1, w1) <= maxDistance / 2 — это ищет прямой проход, — либо в q2 ошибок
+// не больше maxDistance - maxDistance / 2 - 1, и это ищет обратный проход по
+// перевёрнутым словам. Ограничение на часть отсекает верхние уровни бора, где
+// без него подходит почти всё. Длины частей пропорциональны допустимым в них
+// ошибкам плюс один.
+template <typename Matcher>
+void EnglishRussianDictionary::suggestWith(std::string_view english, size_t maxDistance, size_t limit,
+                                           std::vector<Suggestion>& best) const {
+    size_t m = english.size();
+    Matcher matcher(english);
+    if (maxDistance == 0 || m < maxDistance + 1) {
+        collectSuggestions(matcher, PrefixLimit{ 0, 0 }, TreeCursor(this), maxDistance, limit, best);
+        return;
+    }
+
+    size_t headErrors = maxDistance / 2;
+    size_t head = m * (headErrors + 1) / (maxDistance + 1);
+    collectSuggestions(matcher, PrefixLimit{ head, headErrors }, TreeCursor(this), maxDistance, limit, best);
+    if (best.size() == limit && best.back().distance == 0) return;
+
+    std::string reversed(english.rbegin(), english.rend());
+    collectSuggestions(Matcher(reversed), PrefixLimit{ m - head, maxDistance - headErrors - 1 },
+                       ReversedCursor(reversedKeyIndex()), maxDistance, limit, best);
+}
+
+std::vector<EnglishRussianDictionary::Suggestion> EnglishRussianDictionary::suggest(
+    std::string_view english, size_t maxDistance, size_t limit) const {
+    std::vector<Suggestion> best;
+    if (limit == 0) return best;
+    if (!english.empty() && english.size() <= BitParallelMatcher::maxLength)
+        suggestWith<BitParallelMatcher>(english, maxDistance, limit, best);
+    else
+        suggestWith<RowMatcher>(english, maxDistance, limit, best);
+    return best;
+}
+
+CompressedDictionary EnglishRussianDictionary::compress() const {
+    std::vector<std::pair<std::string_view, std::string_view>> sorted;
+    sorted.reserve(size);
+    forEach([&](std::string_view english, std::string_view russian) {
+        sorted.emplace_back(english, russian);
+    });
+    return CompressedDictionary(sorted);
+}
+
+void EnglishRussianDictionary::assignSnapshot(const FrozenDictionary& snapshot) {
+    clear();
+    std::vector<Node*> pending;
+    pending.reserve(snapshot.count());
+    snapshot.forEach([&](std::string_view english, std::string_view russian) {
+        pending.push_back(nodes.create(english, russian));
+    });
+    bulkLoad(pending);
+}
+
+// Возвращает чёрную высоту поддерева или -1 при нарушении свойств
+int EnglishRussianDictionary::checkSubtree(const Node* node, const Node* parent) const {
+    if (!node) return 1;
+    if (node->parent != parent) return -1;
+    if (node->isRed && parent && parent->isRed) return -1;
+    if (node->left && !(node->left->english() < node->english())) return -1;
+    if (node->right && !(node->english() < node->right->english())) return -1;
+    int leftHeight = checkSubtree(node->left, node);
+    int rightHeight = checkSubtree(node->right, node);
+    if (leftHeight < 0 || leftHeight != rightHeight) return -1;
+    if (node->subtreeSize != 1 + sizeOf(node->left) + sizeOf(node->right)) return -1;
+    return leftHeight + (node->isRed ? 0 : 1);
+}
+
+bool EnglishRussianDictionary::validate() const {
+    if (root && root->isRed) return false;
+    return checkSubtree(root, nullptr) >= 0;
+}
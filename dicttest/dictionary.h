@@ -2,42 +2,288 @@
 #ifndef DICTIONARY_H
 #define DICTIONARY_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <vector>
+#include "node_pool.h"
+#include "mapped_file.h"
+#include "hash_index.h"
+#include "bloom_filter.h"
+#include "dictionary_metrics.h"
+
+class FrozenDictionary;
+class CompressedDictionary;
 
 class EnglishRussianDictionary {
+public:
+    // Copy — строки копируются в узлы; Mapped — файл отображается в память,
+    // и узлы ссылаются на текст прямо в нём
+    enum class LoadMode { Copy, Mapped };
+
+    // Разница между словарями; представления действительны до изменения любого из них
+    struct Change {
+        std::string_view english;
+        std::string_view before;
+        std::string_view after;
+    };
+    struct Diff {
+        std::vector<std::pair<std::string_view, std::string_view>> added;
+        std::vector<std::pair<std::string_view, std::string_view>> removed;
+        std::vector<Change> changed;
+    };
+
+    // Результат нечёткого поиска; представления действительны до изменения словаря
+    struct Suggestion {
+        std::string_view english;
+        std::string_view russian;
+        size_t distance;
+    };
+
 private:
     struct Node {
-        std::string english;
-        std::string russian;
+        struct Mapped {};
+
+        // Ключ и перевод хранятся каждый в одном виде: своей строкой или
+        // представлением в отображённый файл. Действующий член объединения
+        // задают englishMapped и isMapped.
+        union {
+            std::string ownedEnglish;
+            std::string_view mappedEnglish;
+        };
+        union {
+            std::string russian;
+            std::string_view mappedRussian;
+        };
+        // Первые 8 байт ключа в порядке big-endian (дополненные нулями):
+        // сравнение чисел совпадает с лексикографическим сравнением этих байт,
+        // и до строки в куче дело доходит только при равенстве префиксов.
+        // Сборка с -DDICTIONARY_PLAIN_COMPARE сравнивает строки целиком (для замеров)
+        uint64_t keyPrefix;
         Node* left;
         Node* right;
         Node* parent;
+        uint32_t subtreeSize; // узлов в поддереве вместе с этим
         bool isRed;
+        bool englishMapped; // ключ лежит в mappedEnglish
+        bool isMapped;      // перевод лежит в mappedRussian
 
-        Node(const char* eng, const char* rus);
-        Node(const std::string& eng, const std::string& rus);
+        Node(std::string_view eng, std::string_view rus);
+        Node(std::string&& eng, std::string&& rus);
+        Node(Mapped, std::string_view eng, std::string_view rus);
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+        ~Node();
+
+        std::string_view english() const {
+            return englishMapped ? mappedEnglish : std::string_view(ownedEnglish);
+        }
+        std::string_view translation() const;
+        std::string& translationRef();
+        void setTranslation(std::string_view rus);
+        void setTranslation(std::string&& rus);
+    };
+
+    struct NodeKey {
+        std::string_view operator()(const Node* node) const { return node->english(); }
+    };
+    struct NodeTranslation {
+        std::string_view operator()(const Node* node) const { return node->translation(); }
     };
 
     Node* root;
     size_t size;
+    NodePool<Node> nodes;
+    std::shared_ptr<MappedFile> mapping;
+    // Необязательный хеш-индекс для точного поиска за одну пробу
+    std::unique_ptr<HashIndex<Node, NodeKey>> hashIndex;
+    // Необязательный фильтр Блума для быстрого отказа по отсутствующим словам
+    std::unique_ptr<BloomFilter> bloom;
+    size_t bloomRemovals; // удалений с последней перестройки фильтра
+    // Необязательный обратный индекс: перевод -> узлы, без копий строк
+    std::unique_ptr<HashIndex<Node, NodeTranslation>> reverseIndex;
+    // Узел, ссылку на перевод которого последним вернул operator[]; он вынут
+    // из обратного индекса и вносится обратно при следующем изменении словаря
+    Node* reversePending;
+    // Порядок слов, прочитанных с конца, для обратного прохода suggest(): указатель
+    // на узел и последние 8 байт слова задом наперёд, как keyPrefix, без копий
+    // ключей. Строится при первом таком поиске и дальше поддерживается при
+    // вставке и удалении.
+    struct ReversedKey {
+        uint64_t suffix;
+        const Node* node;
+    };
+    // Ключ поиска, уже записанный задом наперёд; suffix = prefixOf(reversed)
+    struct ReversedTarget {
+        uint64_t suffix;
+        std::string_view reversed;
+    };
+    struct ReversedLess {
+        using is_transparent = void;
+        bool operator()(const ReversedKey& a, const ReversedKey& b) const;
+        bool operator()(const ReversedKey& a, const ReversedTarget& b) const;
+        bool operator()(const ReversedTarget& a, const ReversedKey& b) const;
+    };
+    using ReversedKeys = std::set<ReversedKey, ReversedLess>;
+    mutable std::mutex reversedKeysMutex;
+    mutable std::unique_ptr<ReversedKeys> reversedKeys;
+#ifdef DICTIONARY_METRICS
+    mutable MetricsCounters metricsCounters;
+#endif
 
     // Вспомогательные методы для красно-черного дерева
     void rotateLeft(Node* node);
     void rotateRight(Node* node);
     void fixInsert(Node* node);
-    void fixDelete(Node* node);
+    void fixDelete(Node* node, Node* parent);
     void transplant(Node* u, Node* v);
     Node* minimum(Node* node) const;
-    Node* find(Node* node, const std::string& key) const;
+    Node* maximum(Node* node) const;
+    Node* successor(Node* node) const;
+    Node* predecessor(Node* node) const;
+    static uint64_t prefixOf(std::string_view key);
+    static int compareKey(std::string_view key, uint64_t keyPrefix, const Node* node);
+    Node* findNode(std::string_view key) const;
+    Node* findInTree(std::string_view key) const;
+    Node* lowerBoundFrom(Node* node, std::string_view key) const;
+    static size_t sizeOf(const Node* node);
+    static void updateSize(Node* node);
+    void attach(Node* newNode);
+    void insertOrAssign(std::string_view english, std::string_view russian);
+    void erase(Node* z);
+    std::string& translationFor(std::string_view english);
     void clear(Node* node);
+    Node* clone(const Node* node, Node* parent);
+    bool loadMapped(const std::string& filename);
+
+    // Построение сбалансированного дерева из массива узлов за O(n)
+    void bulkLoad(std::vector<Node*>& pending);
+    void relink(std::vector<Node*>& sorted);
+    static bool preferPointUpdates(size_t size, size_t changes);
+    Node* buildBalanced(const std::vector<Node*>& sorted, size_t lo, size_t hi,
+                        int depth, int redDepth, Node* parent);
+    int checkSubtree(const Node* node, const Node* parent) const;
+    static int subtreeHeight(const Node* node);
+    struct TreeCursor;
+    struct ReversedCursor;
+    // Начало образца длины length должно совпасть с началом слова не более чем с errors ошибками
+    struct PrefixLimit {
+        size_t length;
+        size_t errors;
+    };
+    template <typename Matcher, typename Cursor>
+    void collectSuggestions(const Matcher& matcher, PrefixLimit prefix, Cursor cursor, size_t maxDistance,
+                            size_t limit, std::vector<Suggestion>& best) const;
+    template <typename Matcher>
+    void suggestWith(std::string_view english, size_t maxDistance, size_t limit,
+                     std::vector<Suggestion>& best) const;
+    const ReversedKeys& reversedKeyIndex() const;
+    void rebuildReversedKeys() const;
+    static ReversedKey reversedKeyOf(const Node* node);
+    void rebuildHashIndex();
+    void rebuildBloomFilter();
+    void rebuildReverseIndex();
+    void indexTranslation(Node* node);
+    void translationWillChange(Node* node);
+    void translationChanged(Node* node);
+    void flushReversePending();
 
 public:
+    // Двунаправленный итератор по словам в порядке возрастания.
+    // Не использует стек: переход к соседу идёт по указателям на родителя.
+    class const_iterator {
+    private:
+        friend class EnglishRussianDictionary;
+        const EnglishRussianDictionary* owner;
+        Node* node;
+        const_iterator(const EnglishRussianDictionary* dict, Node* current) : owner(dict), node(current) {}
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::pair<std::string_view, std::string_view>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        const_iterator() : owner(nullptr), node(nullptr) {}
+
+        value_type operator*() const { return value_type(node->english(), node->translation()); }
+        std::string_view english() const { return node->english(); }
+        std::string_view russian() const { return node->translation(); }
+
+        const_iterator& operator++() {
+            node = owner->successor(node);
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+        // --end() переходит к последнему слову
+        const_iterator& operator--() {
+            node = node ? owner->predecessor(node) : owner->maximum(owner->root);
+            return *this;
+        }
+        const_iterator operator--(int) {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+    };
+    using iterator = const_iterator;
+
+    // Полуоткрытый диапазон [begin, end) для range-for
+    class Range {
+    private:
+        const_iterator first;
+        const_iterator last;
+
+    public:
+        Range(const_iterator from, const_iterator to) : first(from), last(to) {}
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+        bool empty() const { return first == last; }
+    };
+
     EnglishRussianDictionary();
+    EnglishRussianDictionary(const EnglishRussianDictionary& other);
+    EnglishRussianDictionary& operator=(const EnglishRussianDictionary& other);
+    EnglishRussianDictionary(EnglishRussianDictionary&& other) noexcept;
+    EnglishRussianDictionary& operator=(EnglishRussianDictionary&& other) noexcept;
     ~EnglishRussianDictionary();
 
     EnglishRussianDictionary& operator+=(const std::pair<const char*, const char*>& words);
     EnglishRussianDictionary& operator+=(const std::pair<std::string, std::string>& words);
+    EnglishRussianDictionary& operator+=(std::pair<std::string, std::string>&& words);
+    // Слияние и разность словарей. Оба словаря обходятся по порядку за O(n + m),
+    // и дерево перестраивается целиком; если второй словарь намного меньше,
+    // выгоднее m поисков, и тогда слова обрабатываются по одному.
+    // При слиянии побеждает перевод из overlay.
+    EnglishRussianDictionary& operator+=(const EnglishRussianDictionary& overlay);
+    EnglishRussianDictionary& operator-=(const EnglishRussianDictionary& other);
+    // Что нужно добавить, удалить и изменить, чтобы получить other; по возрастанию слов
+    Diff diff(const EnglishRussianDictionary& other) const;
+
+    // Вставка без лишних копий. Строки создаются только если слово действительно
+    // добавляется (try_emplace, emplace) и перемещаются в узел, если переданы как rvalue.
+    // Возвращают итератор на слово и признак того, что оно было добавлено.
+    template <typename Key, typename... Args>
+    std::pair<const_iterator, bool> try_emplace(Key&& english, Args&&... args);
+    template <typename Key, typename Value>
+    std::pair<const_iterator, bool> emplace(Key&& english, Value&& russian);
+    template <typename Key, typename Value>
+    std::pair<const_iterator, bool> insert_or_assign(Key&& english, Value&& russian);
     EnglishRussianDictionary& operator-=(const char* english);
     EnglishRussianDictionary& operator-=(const std::string& english);
     std::string operator[](const char* english) const;
@@ -45,8 +291,149 @@ public:
     std::string& operator[](const char* english);
     std::string& operator[](const std::string& english);
 
+    // Поиск без выделения памяти; представление действительно до изменения записи
+    std::optional<std::string_view> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+
+    // До limit ближайших слов с расстоянием Левенштейна не больше maxDistance,
+    // по возрастанию расстояния, при равенстве — по алфавиту. Слова обходятся
+    // по порядку как бор: столбец ДП для общего префикса с предыдущим словом
+    // переиспользуется, а диапазон слов с префиксом, от которого все продолжения
+    // дальше maxDistance, пропускается целиком через lower_bound.
+    // При maxDistance >= 1 образец делится на две части: у подходящего слова либо
+    // первая совпадает с ошибками не больше maxDistance / 2, либо вторая — с остальными
+    // без одной. Первый случай ищется прямо по дереву, второй — по словам,
+    // упорядоченным с конца: этот порядок строится при первом таком поиске,
+    // дальше обновляется при вставке и удалении (память учитывается в memoryUsage()).
+    std::vector<Suggestion> suggest(std::string_view english, size_t maxDistance, size_t limit = 5) const;
+
+    // Английские слова с переводом russian (точное побайтовое совпадение UTF-8)
+    // в порядке возрастания. Без обратного индекса — полный просмотр словаря.
+    std::vector<std::string_view> findEnglish(std::string_view russian) const;
+
+    // Обратный индекс по переводам хранит указатели на узлы, а не копии строк,
+    // и поддерживается операциями +=, -=, emplace и operator[]. Запись через
+    // ссылку из operator[] учитывается, если сделана до следующего изменения словаря.
+    void enableReverseIndex(bool enable = true);
+    bool hasReverseIndex() const;
+
+    // Хеш-индекс поверх дерева: точные запросы (find, contains, operator[], -=)
+    // идут через него, упорядоченные операции — по-прежнему через дерево
+    void enableHashIndex(bool enable = true);
+    bool hasHashIndex() const;
+
+    // Фильтр Блума перед точным поиском: отсутствующие слова отсекаются
+    // за один промах кэша. Удалённые слова остаются в фильтре до перестройки,
+    // которая происходит после удаления четверти слов.
+    void enableBloomFilter(bool enable = true);
+    bool hasBloomFilter() const;
+    BloomFilter::Stats bloomStats() const;
+
+    // Пакетный поиск: results[i] соответствует keys[i]
+    void lookupBatch(const std::string_view* keys, size_t n,
+                     std::optional<std::string_view>* results) const;
+    std::vector<std::optional<std::string_view>> lookupBatch(
+        const std::vector<std::string_view>& keys) const;
+
     size_t count() const;
-    bool load(const std::string& filename);
+    // Примерный объём памяти: блоки узлов, строки вне узлов и индексы
+    size_t memoryUsage() const;
+    // Форма дерева и память, а в сборке с DICTIONARY_METRICS ещё и счётчики
+    // поисков, сравнений, поворотов и гистограмма задержек. Высота считается за O(n).
+    DictionaryMetrics metrics() const;
+    void resetMetrics();
+    void clear();
+    bool load(const std::string& filename, LoadMode mode = LoadMode::Copy);
+    // Загрузка с разбором и сортировкой файла в threads потоках (0 — по числу ядер).
+    // Результат тот же, что у load(); в режиме Copy файл отображается только на время загрузки.
+    bool loadParallel(const std::string& filename, unsigned threads = 0, LoadMode mode = LoadMode::Copy);
+    // Записывает словарь в порядке возрастания в формате, который читает load()
+    bool save(const std::string& filename) const;
+    // Двоичный формат: заголовок, затем для каждого слова длины и байты слова и перевода.
+    // Переводы строк внутри слов сохраняются; числа — в порядке байтов машины.
+    bool saveBinary(const std::string& filename) const;
+    bool loadBinary(const std::string& filename, LoadMode mode = LoadMode::Copy);
+    // Заменяет содержимое словаря; повторы разрешаются в пользу последнего
+    void assign(const std::vector<std::pair<std::string, std::string>>& words);
+    // Заменяет содержимое копией снимка за O(n) (снимок уже отсортирован)
+    void assignSnapshot(const FrozenDictionary& snapshot);
+
+    // Обход в порядке возрастания ключей: visit(english, russian)
+    template <typename Visitor>
+    void forEach(Visitor visit) const;
+
+    // Итераторы остаются действительными, пока их слово не удалено и словарь не перезагружен
+    const_iterator begin() const;
+    const_iterator end() const;
+    // Первое слово, не меньшее / большее english
+    const_iterator lower_bound(std::string_view english) const;
+    const_iterator upper_bound(std::string_view english) const;
+    std::pair<const_iterator, const_iterator> equal_range(std::string_view english) const;
+    // Все слова, начинающиеся с prefix, за O(log n) на границы; слова читаются по мере обхода
+    Range prefix(std::string_view prefix) const;
+
+    // Порядковые статистики за O(log n): в каждом узле хранится размер поддерева.
+    // Число слов меньше english (english может отсутствовать)
+    size_t rank(std::string_view english) const;
+    // Слово с номером index (с нуля) в порядке возрастания или end()
+    const_iterator select(size_t index) const;
+    // Число слов в [from, to)
+    size_t countRange(std::string_view from, std::string_view to) const;
+    // Равномерно случайное слово (end() для пустого словаря)
+    template <typename Random>
+    const_iterator sample(Random& random) const;
+
+    // Неизменяемый компактный снимок для словарей только на чтение
+    FrozenDictionary freeze() const;
+    // Неизменяемая копия со сжатыми ключами для больших словарей
+    CompressedDictionary compress() const;
+
+    // Проверка свойств красно-черного дерева (для тестов)
+    bool validate() const;
 };
 
+template <typename Key, typename... Args>
+std::pair<EnglishRussianDictionary::const_iterator, bool>
+EnglishRussianDictionary::try_emplace(Key&& english, Args&&... args) {
+    Node* node = findNode(std::string_view(english));
+    if (node)
+        return std::make_pair(const_iterator(this, node), false);
+    node = nodes.create(std::string(std::forward<Key>(english)), std::string(std::forward<Args>(args)...));
+    attach(node);
+    return std::make_pair(const_iterator(this, node), true);
+}
+
+template <typename Key, typename Value>
+std::pair<EnglishRussianDictionary::const_iterator, bool>
+EnglishRussianDictionary::emplace(Key&& english, Value&& russian) {
+    return try_emplace(std::forward<Key>(english), std::forward<Value>(russian));
+}
+
+template <typename Key, typename Value>
+std::pair<EnglishRussianDictionary::const_iterator, bool>
+EnglishRussianDictionary::insert_or_assign(Key&& english, Value&& russian) {
+    Node* node = findNode(std::string_view(english));
+    if (node) {
+        translationWillChange(node);
+        node->setTranslation(std::string(std::forward<Value>(russian)));
+        translationChanged(node);
+        return std::make_pair(const_iterator(this, node), false);
+    }
+    node = nodes.create(std::string(std::forward<Key>(english)), std::string(std::forward<Value>(russian)));
+    attach(node);
+    return std::make_pair(const_iterator(this, node), true);
+}
+
+template <typename Random>
+EnglishRussianDictionary::const_iterator EnglishRussianDictionary::sample(Random& random) const {
+    if (size == 0) return end();
+    return select(std::uniform_int_distribution<size_t>(0, size - 1)(random));
+}
+
+template <typename Visitor>
+void EnglishRussianDictionary::forEach(Visitor visit) const {
+    for (Node* node = minimum(root); node; node = successor(node))
+        visit(node->english(), node->translation());
+}
+
 #endif
\ No newline at end of file
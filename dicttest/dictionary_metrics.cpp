@@ -0,0 +1,71 @@
+﻿#include "dictionary_metrics.h"
+#include <sstream>
+
+double DictionaryMetrics::comparisonsPerSearch() const {
+    return treeSearches ? static_cast<double>(comparisons) / treeSearches : 0.0;
+}
+
+uint64_t DictionaryMetrics::latencyPercentileNanoseconds(double fraction) const {
+    uint64_t total = 0;
+    for (uint64_t bucket : latency)
+        total += bucket;
+    if (total == 0) return 0;
+    uint64_t wanted = static_cast<uint64_t>(fraction * total);
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < latencyBuckets; ++i) {
+        seen += latency[i];
+        if (seen > wanted || seen == total) return uint64_t(1) << (i + 1);
+    }
+    return uint64_t(1) << latencyBuckets;
+}
+
+std::string DictionaryMetrics::toString() const {
+    std::ostringstream out;
+    out << "counting " << (counting ? 1 : 0) << '\n'
+        << "lookups " << lookups << '\n'
+        << "tree_searches " << treeSearches << '\n'
+        << "comparisons " << comparisons << '\n'
+        << "comparisons_per_search " << comparisonsPerSearch() << '\n'
+        << "insert_rotations " << insertRotations << '\n'
+        << "delete_rotations " << deleteRotations << '\n'
+        << "nodes " << nodes << '\n'
+        << "height " << height << '\n'
+        << "black_height " << blackHeight << '\n'
+        << "node_bytes " << nodeBytes << '\n'
+        << "memory_bytes " << memoryBytes << '\n'
+        << "lookup_ns_p50 " << latencyPercentileNanoseconds(0.5) << '\n'
+        << "lookup_ns_p99 " << latencyPercentileNanoseconds(0.99) << '\n';
+    for (unsigned i = 0; i < latencyBuckets; ++i)
+        if (latency[i])
+            out << "lookup_ns_bucket{le=\"" << (uint64_t(1) << (i + 1)) << "\"} " << latency[i] << '\n';
+    return out.str();
+}
+
+void MetricsCounters::reset() {
+    lookups.store(0, std::memory_order_relaxed);
+    treeSearches.store(0, std::memory_order_relaxed);
+    comparisons.store(0, std::memory_order_relaxed);
+    insertRotations.store(0, std::memory_order_relaxed);
+    deleteRotations.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint64_t>& bucket : latency)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+void MetricsCounters::recordLatency(std::chrono::steady_clock::duration elapsed) {
+    uint64_t nanoseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    unsigned bucket = 0;
+    while (bucket + 1 < DictionaryMetrics::latencyBuckets && nanoseconds >> (bucket + 1))
+        bucket++;
+    latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsCounters::collect(DictionaryMetrics& metrics) const {
+    metrics.lookups = lookups.load(std::memory_order_relaxed);
+    metrics.treeSearches = treeSearches.load(std::memory_order_relaxed);
+    metrics.comparisons = comparisons.load(std::memory_order_relaxed);
+    metrics.insertRotations = insertRotations.load(std::memory_order_relaxed);
+    metrics.deleteRotations = deleteRotations.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < DictionaryMetrics::latencyBuckets; ++i)
+        metrics.latency[i] = latency[i].load(std::memory_order_relaxed);
+}
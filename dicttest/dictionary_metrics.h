@@ -0,0 +1,101 @@
+#pragma once
+#ifndef DICTIONARY_METRICS_H
+#define DICTIONARY_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Счётчики горячего пути EnglishRussianDictionary включаются при сборке
+// макросом DICTIONARY_METRICS (одинаково для всех единиц трансляции).
+// Без него счётчиков в словаре нет вовсе, а DICTIONARY_METRIC(...) ничего
+// не порождает; форма дерева и память считаются в metrics() в любой сборке.
+#ifdef DICTIONARY_METRICS
+#define DICTIONARY_METRIC(...) __VA_ARGS__
+#else
+#define DICTIONARY_METRIC(...)
+#endif
+
+// Снимок показателей словаря
+struct DictionaryMetrics {
+    // Корзина i гистограммы задержек — поиски длительностью [2^i, 2^(i+1)) нс.
+    // Время замеряется у каждого latencySampling-го поиска в потоке: чтение часов
+    // стоит дольше спуска по верхним уровням дерева.
+    static constexpr unsigned latencyBuckets = 32;
+    static constexpr unsigned latencySampling = 16;
+
+    bool counting;              // собрано с DICTIONARY_METRICS
+    uint64_t lookups;           // find, contains и operator[] без изменения словаря
+    uint64_t treeSearches;      // спусков по дереву, включая поиски внутри изменений
+    uint64_t comparisons;       // сравнений ключей в этих спусках
+    uint64_t insertRotations;   // поворотов в fixInsert
+    uint64_t deleteRotations;   // поворотов в fixDelete
+    uint64_t latency[latencyBuckets]; // замеренные поиски
+
+    size_t nodes;
+    int height;                 // узлов на самом длинном пути от корня
+    int blackHeight;            // чёрных узлов на пути от корня до листа
+    size_t nodeBytes;           // блоки пула узлов
+    size_t memoryBytes;         // всего, как memoryUsage()
+
+    double comparisonsPerSearch() const;
+    // Верхняя граница корзины, в которую попадает доля fraction поисков (0 — поисков не было)
+    uint64_t latencyPercentileNanoseconds(double fraction) const;
+    // Текстовый вид «имя значение» по строке на показатель
+    std::string toString() const;
+};
+
+// Счётчики, которые словарь обновляет на горячем пути. Атомарные, потому что
+// поиск константен и может идти из нескольких потоков сразу. Копия словаря
+// начинает счёт с нуля.
+class MetricsCounters {
+public:
+    std::atomic<uint64_t> lookups;
+    std::atomic<uint64_t> treeSearches;
+    std::atomic<uint64_t> comparisons;
+    std::atomic<uint64_t> insertRotations;
+    std::atomic<uint64_t> deleteRotations;
+    std::atomic<uint64_t> latency[DictionaryMetrics::latencyBuckets];
+
+    MetricsCounters() { reset(); }
+    MetricsCounters(const MetricsCounters&) : MetricsCounters() {}
+    MetricsCounters& operator=(const MetricsCounters&) { return *this; }
+
+    void reset();
+    void recordSearch(uint64_t comparisonCount) {
+        treeSearches.fetch_add(1, std::memory_order_relaxed);
+        comparisons.fetch_add(comparisonCount, std::memory_order_relaxed);
+    }
+    void countInsertRotation() { insertRotations.fetch_add(1, std::memory_order_relaxed); }
+    void countDeleteRotation() { deleteRotations.fetch_add(1, std::memory_order_relaxed); }
+    void recordLatency(std::chrono::steady_clock::duration elapsed);
+    // Заполняет счётчики снимка
+    void collect(DictionaryMetrics& metrics) const;
+
+    // Учитывает поиск при выходе из области видимости; время засекается
+    // только у поисков, попавших в выборку
+    class LookupTimer {
+    private:
+        MetricsCounters& counters;
+        bool sampled;
+        std::chrono::steady_clock::time_point start;
+
+        static bool nextSampled() {
+            static thread_local unsigned tick = 0;
+            return ++tick % DictionaryMetrics::latencySampling == 0;
+        }
+
+    public:
+        explicit LookupTimer(MetricsCounters& target) : counters(target), sampled(nextSampled()) {
+            if (sampled) start = std::chrono::steady_clock::now();
+        }
+        ~LookupTimer() {
+            counters.lookups.fetch_add(1, std::memory_order_relaxed);
+            if (sampled) counters.recordLatency(std::chrono::steady_clock::now() - start);
+        }
+    };
+};
+
+#endif
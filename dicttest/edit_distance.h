@@ -0,0 +1,166 @@
+#pragma once
+#ifndef EDIT_DISTANCE_H
+#define EDIT_DISTANCE_H
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Расстояние Левенштейна от фиксированного образца до слова, которое
+// наращивается по символу. Состояние — столбец таблицы ДП для текущего
+// префикса слова; по нему известны расстояние до самого префикса (distance)
+// и нижняя граница расстояния до любого его продолжения (lowerBound).
+// Это позволяет обходить упорядоченные слова как бор и отсекать целые
+// поддиапазоны с общим префиксом.
+//
+// Все символы, которых нет в образце, действуют на столбец одинаково, поэтому
+// при поиске следующего подходящего символа достаточно проверить символы
+// образца (symbols) и один любой другой (other).
+//
+// Варианты distance и lowerBound с параметром rows считают то же для начала
+// образца длины rows: строка rows таблицы — расстояния от этого начала.
+class PatternSymbols {
+private:
+    std::vector<unsigned char> sorted;
+    int outside;
+
+public:
+    explicit PatternSymbols(std::string_view pattern) : outside(-1) {
+        bool seen[256] = {};
+        for (char c : pattern)
+            seen[static_cast<unsigned char>(c)] = true;
+        for (int c = 0; c < 256; ++c) {
+            if (seen[c])
+                sorted.push_back(static_cast<unsigned char>(c));
+            else if (outside < 0)
+                outside = c;
+        }
+    }
+
+    // Различные символы образца по возрастанию
+    const std::vector<unsigned char>& symbols() const { return sorted; }
+    // Какой-нибудь символ не из образца или -1, если образец содержит все
+    int other() const { return outside; }
+};
+
+// Битово-параллельный вариант Майерса (в формулировке Хюрё) для образцов
+// до 64 байт: столбец хранится как два битовых вектора вертикальных приращений,
+// и шаг стоит несколько машинных операций.
+class BitParallelMatcher : public PatternSymbols {
+private:
+    uint64_t peq[256];
+    size_t m;
+    uint64_t top;
+
+public:
+    static constexpr size_t maxLength = 64;
+
+    struct State {
+        uint64_t vp; // D[i][j] - D[i-1][j] == +1
+        uint64_t vn; // D[i][j] - D[i-1][j] == -1
+        size_t depth;
+        size_t score; // D[m][j]
+    };
+
+    // 1 <= pattern.size() <= maxLength
+    explicit BitParallelMatcher(std::string_view pattern)
+        : PatternSymbols(pattern), m(pattern.size()), top(uint64_t(1) << (m - 1)) {
+        std::fill(peq, peq + 256, 0);
+        for (size_t i = 0; i < m; ++i)
+            peq[static_cast<unsigned char>(pattern[i])] |= uint64_t(1) << i;
+    }
+
+    State initial() const {
+        return State{ m == 64 ? ~uint64_t(0) : (uint64_t(1) << m) - 1, 0, 0, m };
+    }
+
+    void advance(const State& from, unsigned char c, State& to) const {
+        uint64_t eq = peq[c];
+        uint64_t d0 = (((eq & from.vp) + from.vp) ^ from.vp) | eq | from.vn;
+        uint64_t hp = from.vn | ~(d0 | from.vp);
+        uint64_t hn = from.vp & d0;
+        to.score = from.score + ((hp & top) ? 1 : 0) - ((hn & top) ? 1 : 0);
+        hp = (hp << 1) | 1; // первая строка таблицы растёт на 1 с каждым символом
+        hn <<= 1;
+        to.vp = hn | ~(d0 | hp);
+        to.vn = hp & d0;
+        to.depth = from.depth + 1;
+    }
+
+    size_t distance(const State& state) const { return state.score; }
+    size_t distance(const State& state, size_t rows) const {
+        uint64_t mask = rows == 64 ? ~uint64_t(0) : (uint64_t(1) << rows) - 1;
+        return state.depth + std::bitset<64>(state.vp & mask).count() - std::bitset<64>(state.vn & mask).count();
+    }
+
+    // Минимум столбца: D[0][j] = j плюс накопленные вертикальные приращения
+    size_t lowerBound(const State& state) const { return lowerBound(state, m); }
+    size_t lowerBound(const State& state, size_t rows) const {
+        long value = static_cast<long>(state.depth);
+        long best = value;
+        for (size_t i = 0; i < rows; ++i) {
+            value += ((state.vp >> i) & 1) - long((state.vn >> i) & 1);
+            best = std::min(best, value);
+        }
+        return static_cast<size_t>(best);
+    }
+};
+
+// Обычное ДП по столбцам для образцов любой длины
+class RowMatcher : public PatternSymbols {
+private:
+    std::string_view pattern;
+
+public:
+    using State = std::vector<size_t>;
+
+    explicit RowMatcher(std::string_view text) : PatternSymbols(text), pattern(text) {}
+
+    State initial() const {
+        State column(pattern.size() + 1);
+        for (size_t i = 0; i < column.size(); ++i)
+            column[i] = i;
+        return column;
+    }
+
+    void advance(const State& from, unsigned char c, State& to) const {
+        to.resize(from.size());
+        to[0] = from[0] + 1;
+        for (size_t i = 1; i < from.size(); ++i) {
+            size_t replace = from[i - 1] + (static_cast<unsigned char>(pattern[i - 1]) != c ? 1 : 0);
+            to[i] = std::min(std::min(from[i], to[i - 1]) + 1, replace);
+        }
+    }
+
+    size_t distance(const State& state) const { return state.back(); }
+    size_t distance(const State& state, size_t rows) const { return state[rows]; }
+    size_t lowerBound(const State& state) const { return *std::min_element(state.begin(), state.end()); }
+    size_t lowerBound(const State& state, size_t rows) const {
+        return *std::min_element(state.begin(), state.begin() + rows + 1);
+    }
+};
+
+// Расстояние Левенштейна между двумя строками
+inline size_t editDistance(std::string_view a, std::string_view b) {
+    if (a.size() < b.size()) std::swap(a, b);
+    if (b.empty()) return a.size();
+    if (b.size() <= BitParallelMatcher::maxLength) {
+        BitParallelMatcher matcher(b);
+        BitParallelMatcher::State state = matcher.initial();
+        for (char c : a)
+            matcher.advance(state, static_cast<unsigned char>(c), state);
+        return matcher.distance(state);
+    }
+    RowMatcher matcher(b);
+    RowMatcher::State state = matcher.initial(), next;
+    for (char c : a) {
+        matcher.advance(state, static_cast<unsigned char>(c), next);
+        state.swap(next);
+    }
+    return matcher.distance(state);
+}
+
+#endif
@@ -0,0 +1,200 @@
+﻿#include "frozen_dictionary.h"
+#include "prefetch.h"
+#include <cstring>
+#include <fstream>
+
+namespace {
+const char frozenMagic[8] = { 'E', 'R', 'D', 'F', 'R', 'Z', '1', '\0' };
+}
+
+FrozenDictionary::FrozenDictionary()
+    : FrozenDictionary(std::vector<std::pair<std::string_view, std::string_view>>()) {
+}
+
+FrozenDictionary::FrozenDictionary(const std::vector<std::pair<std::string_view, std::string_view>>& sorted)
+    : entries(nullptr), blob(nullptr), blobSize(0), n(0) {
+    size_t count = sorted.size();
+
+    // order[k] — номер пары, стоящей в позиции k раскладки Эйтцингера
+    std::vector<size_t> order(count + 1);
+    size_t next = 0;
+    size_t k = 1;
+    // Симметричный обход неявного дерева раздаёт пары по позициям по возрастанию
+    while (k <= count && 2 * k <= count)
+        k = 2 * k;
+    for (size_t i = 0; i < count; ++i) {
+        order[k] = next++;
+        if (2 * k + 1 <= count) {
+            k = 2 * k + 1;
+            while (2 * k <= count)
+                k = 2 * k;
+        }
+        else {
+            while (k & 1)
+                k >>= 1;
+            k >>= 1;
+        }
+    }
+
+    uint64_t blobSize = 0;
+    for (const auto& word : sorted)
+        blobSize += word.first.size() + word.second.size();
+
+    size_t entriesBytes = (count + 1) * sizeof(Entry);
+    buffer.resize(sizeof(Header) + entriesBytes + blobSize);
+
+    Header header;
+    std::memcpy(header.magic, frozenMagic, sizeof(frozenMagic));
+    header.count = count;
+    header.blobSize = blobSize;
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+
+    // Строки кладутся в порядке раскладки: верхние уровни поиска оказываются рядом
+    Entry* out = reinterpret_cast<Entry*>(buffer.data() + sizeof(Header));
+    char* text = buffer.data() + sizeof(Header) + entriesBytes;
+    out[0] = Entry{ 0, 0, 0 };
+    uint64_t offset = 0;
+    for (size_t pos = 1; pos <= count; ++pos) {
+        const auto& word = sorted[order[pos]];
+        out[pos].offset = offset;
+        out[pos].keyLength = static_cast<uint32_t>(word.first.size());
+        out[pos].valueLength = static_cast<uint32_t>(word.second.size());
+        if (!word.first.empty())
+            std::memcpy(text + offset, word.first.data(), word.first.size());
+        offset += word.first.size();
+        if (!word.second.empty())
+            std::memcpy(text + offset, word.second.data(), word.second.size());
+        offset += word.second.size();
+    }
+
+    attach(buffer.data(), buffer.size());
+}
+
+FrozenDictionary::FrozenDictionary(FrozenDictionary&& other) noexcept
+    : buffer(std::move(other.buffer)), file(std::move(other.file)),
+      entries(other.entries), blob(other.blob), blobSize(other.blobSize), n(other.n) {
+    other.entries = nullptr;
+    other.blob = nullptr;
+    other.blobSize = 0;
+    other.n = 0;
+}
+
+FrozenDictionary& FrozenDictionary::operator=(FrozenDictionary&& other) noexcept {
+    if (this != &other) {
+        buffer = std::move(other.buffer);
+        file = std::move(other.file);
+        entries = other.entries;
+        blob = other.blob;
+        blobSize = other.blobSize;
+        n = other.n;
+        other.entries = nullptr;
+        other.blob = nullptr;
+        other.blobSize = 0;
+        other.n = 0;
+    }
+    return *this;
+}
+
+const char* FrozenDictionary::image() const {
+    return file ? file->data() : buffer.data();
+}
+
+size_t FrozenDictionary::imageSize() const {
+    return file ? file->size() : buffer.size();
+}
+
+// Проверяет заголовок и размеры и настраивает указатели на образ
+bool FrozenDictionary::attach(const char* data, size_t length) {
+    if (length < sizeof(Header)) return false;
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, frozenMagic, sizeof(frozenMagic)) != 0) return false;
+    if (header.count > (length - sizeof(Header)) / sizeof(Entry)) return false;
+
+    size_t entriesBytes = (header.count + 1) * sizeof(Entry);
+    if (sizeof(Header) + entriesBytes > length ||
+        header.blobSize != length - sizeof(Header) - entriesBytes)
+        return false;
+
+    entries = reinterpret_cast<const Entry*>(data + sizeof(Header));
+    blob = data + sizeof(Header) + entriesBytes;
+    blobSize = header.blobSize;
+    n = header.count;
+    return true;
+}
+
+// Запись, выходящая за блок строк, бывает только в повреждённом файле
+std::string_view FrozenDictionary::keyAt(size_t index) const {
+    const Entry& entry = entries[index];
+    if (!entryFits(entry)) return std::string_view();
+    return std::string_view(blob + entry.offset, entry.keyLength);
+}
+
+std::string_view FrozenDictionary::valueAt(size_t index) const {
+    const Entry& entry = entries[index];
+    if (!entryFits(entry)) return std::string_view();
+    return std::string_view(blob + entry.offset + entry.keyLength, entry.valueLength);
+}
+
+// Позиция первого ключа, не меньшего key, или 0
+size_t FrozenDictionary::lowerBound(std::string_view key) const {
+    size_t k = 1;
+    while (k <= n) {
+        // Шестнадцать потомков на четыре уровня ниже лежат подряд
+        prefetchRead(entries + 16 * k);
+        k = 2 * k + (keyAt(k) < key ? 1 : 0);
+    }
+    // Снимаем повороты вправо, совершённые после последнего шага влево
+    while (k & 1)
+        k >>= 1;
+    return k >> 1;
+}
+
+std::optional<std::string_view> FrozenDictionary::find(std::string_view english) const {
+    size_t k = lowerBound(english);
+    if (k == 0 || keyAt(k) != english) return std::nullopt;
+    return valueAt(k);
+}
+
+std::string FrozenDictionary::operator[](std::string_view english) const {
+    std::optional<std::string_view> russian = find(english);
+    return russian ? std::string(*russian) : std::string();
+}
+
+bool FrozenDictionary::contains(std::string_view english) const {
+    return find(english).has_value();
+}
+
+size_t FrozenDictionary::count() const {
+    return n;
+}
+
+bool FrozenDictionary::save(const std::string& filename) const {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) return false;
+    out.write(image(), static_cast<std::streamsize>(imageSize()));
+    // Хвост образа может остаться в буфере потока: ошибка его записи
+    // (например, нет места) видна только после flush и close
+    out.flush();
+    out.close();
+    return !out.fail();
+}
+
+bool FrozenDictionary::verify() const {
+    for (size_t i = 1; i <= n; ++i) {
+        if (!entryFits(entries[i])) return false;
+    }
+    return true;
+}
+
+bool FrozenDictionary::open(const std::string& filename) {
+    std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>();
+    if (!mapped->open(filename)) return false;
+
+    FrozenDictionary opened;
+    opened.buffer.clear();
+    opened.file = mapped;
+    if (!opened.attach(mapped->data(), mapped->size())) return false;
+    *this = std::move(opened);
+    return true;
+}
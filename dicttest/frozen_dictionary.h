@@ -0,0 +1,104 @@
+#pragma once
+#ifndef FROZEN_DICTIONARY_H
+#define FROZEN_DICTIONARY_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mapped_file.h"
+
+// Неизменяемый словарь: все строки лежат в одном блоке, а массив записей
+// упорядочен по Эйтцингеру (в порядке обхода в ширину), поэтому бинарный поиск
+// идёт без ветвлений по индексу и хорошо предсказывается.
+//
+// Формат файла совпадает с представлением в памяти, поэтому open() отображает
+// файл и проверяет только заголовок и размеры — записи не читаются, и открытие
+// не зависит от числа слов. Границы записи сверяются с блоком строк при каждом
+// обращении: запись повреждённого файла, выходящая за блок, читается как пустые
+// строки. verify() проверяет все записи сразу. Числа хранятся в порядке байтов
+// машины, на которой снимок создан.
+class FrozenDictionary {
+private:
+    struct Header {
+        char magic[8];
+        uint64_t count;
+        uint64_t blobSize;
+    };
+
+    // Перевод хранится в блоке сразу после ключа
+    struct Entry {
+        uint64_t offset;
+        uint32_t keyLength;
+        uint32_t valueLength;
+    };
+
+    std::vector<char> buffer;
+    std::shared_ptr<MappedFile> file;
+    const Entry* entries; // индексы 1..n, entries[0] не используется
+    const char* blob;
+    uint64_t blobSize;
+    size_t n;
+
+    const char* image() const;
+    size_t imageSize() const;
+    bool attach(const char* data, size_t length);
+    bool entryFits(const Entry& entry) const {
+        return entry.offset <= blobSize &&
+               uint64_t(entry.keyLength) + entry.valueLength <= blobSize - entry.offset;
+    }
+    std::string_view keyAt(size_t index) const;
+    std::string_view valueAt(size_t index) const;
+    size_t lowerBound(std::string_view key) const;
+
+public:
+    FrozenDictionary();
+    // sorted — пары с уникальными ключами в порядке возрастания
+    explicit FrozenDictionary(const std::vector<std::pair<std::string_view, std::string_view>>& sorted);
+
+    FrozenDictionary(const FrozenDictionary&) = delete;
+    FrozenDictionary& operator=(const FrozenDictionary&) = delete;
+    FrozenDictionary(FrozenDictionary&& other) noexcept;
+    FrozenDictionary& operator=(FrozenDictionary&& other) noexcept;
+
+    std::string operator[](std::string_view english) const;
+    std::optional<std::string_view> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+    size_t count() const;
+
+    // Обход в порядке возрастания ключей: visit(english, russian)
+    template <typename Visitor>
+    void forEach(Visitor visit) const;
+
+    // false, если файл не удалось записать целиком
+    bool save(const std::string& filename) const;
+    bool open(const std::string& filename);
+    // Все ли записи целиком лежат в блоке строк; читает весь массив записей
+    bool verify() const;
+};
+
+template <typename Visitor>
+void FrozenDictionary::forEach(Visitor visit) const {
+    // Симметричный обход неявного дерева 1..n без стека
+    size_t k = 1;
+    while (k <= n && 2 * k <= n)
+        k = 2 * k;
+    for (size_t i = 0; i < n; ++i) {
+        visit(keyAt(k), valueAt(k));
+        if (2 * k + 1 <= n) {
+            k = 2 * k + 1;
+            while (2 * k <= n)
+                k = 2 * k;
+        }
+        else {
+            while (k & 1)
+                k >>= 1;
+            k >>= 1;
+        }
+    }
+}
+
+#endif
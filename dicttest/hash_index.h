@@ -0,0 +1,247 @@
+#pragma once
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "key_hash.h"
+#include "prefetch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_INDEX_SSE2 1
+#endif
+
+// Хеш-индекс с открытой адресацией в стиле SwissTable: на каждую ячейку есть
+// управляющий байт (7 бит хеша или признак пустой/удалённой ячейки), и группа
+// из 16 таких байтов сравнивается с искомым значением одной SSE2-инструкцией.
+// Полный хеш ключа хранится рядом с указателем, поэтому строки сравниваются
+// только при совпадении всех 64 бит, а рост таблицы не пересчитывает хеши.
+//
+// Хранит указатели на внешние объекты, ключ которых возвращает KeyOf.
+// Через insert/erase с явным хешем индекс работает и как многозначный:
+// одинаковые ключи допускаются, а записи находит forEachEqual.
+template <typename T, typename KeyOf>
+class HashIndex {
+private:
+    static constexpr size_t groupSize = 16;
+    static constexpr int8_t emptyByte = -128;  // 0b10000000
+    static constexpr int8_t deletedByte = -2;  // 0b11111110
+
+    std::vector<int8_t> control;
+    std::vector<uint64_t> hashes;
+    std::vector<T*> values;
+    size_t groupMask; // число групп - 1
+    size_t used;      // живые записи
+    size_t tombstones;
+
+    static int8_t shortHash(uint64_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+    static size_t groupStart(uint64_t hash) { return static_cast<size_t>(hash >> 7); }
+
+    // Маска ячеек группы, у которых управляющий байт равен value
+    uint32_t match(size_t group, int8_t value) const {
+        const int8_t* bytes = control.data() + group * groupSize;
+#ifdef HASH_INDEX_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < groupSize; ++i)
+            if (bytes[i] == value) mask |= 1u << i;
+        return mask;
+#endif
+    }
+
+    // Маска пустых или удалённых ячеек (старший бит установлен только у них)
+    uint32_t matchFree(size_t group) const {
+        const int8_t* bytes = control.data() + group * groupSize;
+#ifdef HASH_INDEX_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < groupSize; ++i)
+            if (bytes[i] < 0) mask |= 1u << i;
+        return mask;
+#endif
+    }
+
+    static unsigned lowestBit(uint32_t mask) {
+        unsigned bit = 0;
+        while (!(mask & 1u)) {
+            mask >>= 1;
+            bit++;
+        }
+        return bit;
+    }
+
+    void place(T* value, uint64_t hash) {
+        size_t group = groupStart(hash) & groupMask;
+        for (size_t step = 1;; ++step) {
+            uint32_t free = matchFree(group);
+            if (free) {
+                size_t slot = group * groupSize + lowestBit(free);
+                if (control[slot] == deletedByte) tombstones--;
+                control[slot] = shortHash(hash);
+                hashes[slot] = hash;
+                values[slot] = value;
+                used++;
+                return;
+            }
+            group = (group + step) & groupMask; // треугольные числа обходят все группы
+        }
+    }
+
+    void rehash(size_t groups) {
+        std::vector<int8_t> oldControl(groups * groupSize, emptyByte);
+        std::vector<uint64_t> oldHashes(groups * groupSize);
+        std::vector<T*> oldValues(groups * groupSize, nullptr);
+        oldControl.swap(control);
+        oldHashes.swap(hashes);
+        oldValues.swap(values);
+        groupMask = groups - 1;
+        used = 0;
+        tombstones = 0;
+        for (size_t i = 0; i < oldControl.size(); ++i)
+            if (oldControl[i] >= 0)
+                place(oldValues[i], oldHashes[i]);
+    }
+
+    // Если в группе есть пустая ячейка, поиск через неё не проходит,
+    // и ячейку можно освободить без надгробия
+    void release(size_t slot) {
+        size_t group = slot / groupSize;
+        if (match(group, emptyByte)) {
+            control[slot] = emptyByte;
+        }
+        else {
+            control[slot] = deletedByte;
+            tombstones++;
+        }
+        values[slot] = nullptr;
+        used--;
+    }
+
+    size_t findSlot(std::string_view key, uint64_t hash) const {
+        size_t group = groupStart(hash) & groupMask;
+        int8_t tag = shortHash(hash);
+        for (size_t step = 1;; ++step) {
+            uint32_t candidates = match(group, tag);
+            while (candidates) {
+                size_t slot = group * groupSize + lowestBit(candidates);
+                if (hashes[slot] == hash && KeyOf()(values[slot]) == key)
+                    return slot;
+                candidates &= candidates - 1;
+            }
+            if (match(group, emptyByte))
+                return npos;
+            group = (group + step) & groupMask;
+        }
+    }
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    HashIndex() : control(groupSize, emptyByte), hashes(groupSize), values(groupSize, nullptr),
+                  groupMask(0), used(0), tombstones(0) {}
+
+    size_t size() const { return used; }
+
+    void clear() {
+        HashIndex empty;
+        control.swap(empty.control);
+        hashes.swap(empty.hashes);
+        values.swap(empty.values);
+        groupMask = 0;
+        used = 0;
+        tombstones = 0;
+    }
+
+    // Готовит таблицу под count записей без промежуточных перестроек
+    void reserve(size_t count) {
+        size_t groups = groupMask + 1;
+        while (count > groups * groupSize * 7 / 8)
+            groups *= 2;
+        if (groups != groupMask + 1)
+            rehash(groups);
+    }
+
+    T* find(std::string_view key) const {
+        return find(key, hashKey(key));
+    }
+
+    T* find(std::string_view key, uint64_t hash) const {
+        size_t slot = findSlot(key, hash);
+        return slot == npos ? nullptr : values[slot];
+    }
+
+    // Подсказка кэшу перед find по заранее посчитанному хешу
+    void prefetch(uint64_t hash) const {
+        size_t group = groupStart(hash) & groupMask;
+        prefetchRead(control.data() + group * groupSize);
+        prefetchRead(hashes.data() + group * groupSize);
+    }
+
+    // Ключ value не должен уже присутствовать в индексе
+    void insert(T* value) {
+        insert(value, hashKey(KeyOf()(value)));
+    }
+
+    void erase(T* value) {
+        erase(value, hashKey(KeyOf()(value)));
+    }
+
+    // Вставка с заранее посчитанным хешем; ключ может уже встречаться
+    void insert(T* value, uint64_t hash) {
+        size_t capacity = (groupMask + 1) * groupSize;
+        if (used + tombstones + 1 > capacity * 7 / 8)
+            rehash(used + 1 > capacity / 2 ? (groupMask + 1) * 2 : groupMask + 1);
+        place(value, hash);
+    }
+
+    // Удаляет именно value, даже если его ключ встречается у других объектов
+    void erase(T* value, uint64_t hash) {
+        size_t group = groupStart(hash) & groupMask;
+        int8_t tag = shortHash(hash);
+        for (size_t step = 1;; ++step) {
+            uint32_t candidates = match(group, tag);
+            while (candidates) {
+                size_t slot = group * groupSize + lowestBit(candidates);
+                if (values[slot] == value) {
+                    release(slot);
+                    return;
+                }
+                candidates &= candidates - 1;
+            }
+            if (match(group, emptyByte))
+                return;
+            group = (group + step) & groupMask;
+        }
+    }
+
+    // Вызывает visit(T*) для всех записей с ключом key
+    template <typename Visitor>
+    void forEachEqual(std::string_view key, uint64_t hash, Visitor visit) const {
+        size_t group = groupStart(hash) & groupMask;
+        int8_t tag = shortHash(hash);
+        for (size_t step = 1;; ++step) {
+            uint32_t candidates = match(group, tag);
+            while (candidates) {
+                size_t slot = group * groupSize + lowestBit(candidates);
+                if (hashes[slot] == hash && KeyOf()(values[slot]) == key)
+                    visit(values[slot]);
+                candidates &= candidates - 1;
+            }
+            if (match(group, emptyByte))
+                return;
+            group = (group + step) & groupMask;
+        }
+    }
+
+    size_t memoryUsage() const {
+        return control.size() * (sizeof(int8_t) + sizeof(uint64_t) + sizeof(T*));
+    }
+};
+
+#endif
@@ -0,0 +1,341 @@
+﻿#include "journaled_dictionary.h"
+#include "frozen_dictionary.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char journalMagic[8] = { 'E', 'R', 'D', 'J', 'R', 'N', '1', '\0' };
+
+// Заголовок записи: crc32, длина слова, длина перевода, операция.
+// CRC считается по всему, что идёт после него.
+const size_t recordHeaderSize = 13;
+const char addOperation = '+';
+const char removeOperation = '-';
+
+uint32_t crc32(const char* data, size_t length) {
+    static const struct Table {
+        uint32_t values[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+                values[i] = crc;
+            }
+        }
+    } table;
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i)
+        crc = table.values[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+#ifdef _WIN32
+int openForAppend(const std::string& filename) {
+    return _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+bool writeAll(int file, const char* data, size_t length) {
+    while (length > 0) {
+        unsigned chunk = static_cast<unsigned>(length < 0x40000000 ? length : 0x40000000);
+        int written = _write(file, data, chunk);
+        if (written <= 0) return false;
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool syncFile(int file) { return _commit(file) == 0; }
+bool truncateFile(int file, size_t length) { return _chsize_s(file, static_cast<__int64>(length)) == 0; }
+void closeFile(int file) { _close(file); }
+
+bool replaceFile(const std::string& from, const std::string& to) {
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+bool syncPath(const std::string& filename) {
+    int file = _open(filename.c_str(), _O_RDWR | _O_BINARY);
+    if (file < 0) return false;
+    bool synced = syncFile(file);
+    _close(file);
+    return synced;
+}
+
+void syncDirectoryOf(const std::string&) {} // MOVEFILE_WRITE_THROUGH уже дожидается записи
+#else
+int openForAppend(const std::string& filename) {
+    return ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+}
+
+bool writeAll(int file, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(file, data, length);
+        if (written <= 0) return false;
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool syncFile(int file) { return ::fsync(file) == 0; }
+bool truncateFile(int file, size_t length) { return ::ftruncate(file, static_cast<off_t>(length)) == 0; }
+void closeFile(int file) { ::close(file); }
+
+bool replaceFile(const std::string& from, const std::string& to) {
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool syncPath(const std::string& filename) {
+    int file = ::open(filename.c_str(), O_RDONLY);
+    if (file < 0) return false;
+    bool synced = syncFile(file);
+    ::close(file);
+    return synced;
+}
+
+// Переименование становится надёжным только после fsync каталога
+void syncDirectoryOf(const std::string& filename) {
+    size_t slash = filename.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : filename.substr(0, slash + 1);
+    int file = ::open(directory.c_str(), O_RDONLY);
+    if (file < 0) return;
+    ::fsync(file);
+    ::close(file);
+}
+#endif
+
+bool fileExists(const std::string& filename) {
+    return std::ifstream(filename).is_open();
+}
+
+}
+
+JournaledDictionary::JournaledDictionary()
+    : journalFile(-1), journalBytes(0), groupCommitBytes(defaultGroupCommitBytes),
+      compactionBytes(defaultCompactionBytes), failed(false) {
+}
+
+JournaledDictionary::~JournaledDictionary() {
+    close();
+}
+
+bool JournaledDictionary::open(const std::string& path) {
+    close();
+    failed = false;
+    snapshotPath = path + ".snapshot";
+    journalPath = path + ".journal";
+    dict.clear();
+
+    if (fileExists(snapshotPath)) {
+        FrozenDictionary snapshot;
+        // Снимок всё равно читается целиком, поэтому записи проверяются сразу
+        if (!snapshot.open(snapshotPath) || !snapshot.verify()) return false;
+        dict.assignSnapshot(snapshot);
+    }
+    if (!replay(journalPath)) {
+        dict.clear();
+        return false;
+    }
+
+    journalFile = openForAppend(journalPath);
+    if (journalFile < 0) return false;
+    // Оборванный хвост отрезается, чтобы новые записи шли сразу за последней целой
+    bool ready = truncateFile(journalFile, journalBytes);
+    if (ready && journalBytes == 0) {
+        ready = writeAll(journalFile, journalMagic, sizeof(journalMagic));
+        journalBytes = sizeof(journalMagic);
+    }
+    if (!ready || !syncFile(journalFile)) {
+        closeFile(journalFile);
+        journalFile = -1;
+        return false;
+    }
+    return true;
+}
+
+// Применяет целые записи журнала; journalBytes — конец последней из них
+bool JournaledDictionary::replay(const std::string& filename) {
+    journalBytes = 0;
+    MappedFile file;
+    if (!file.open(filename)) return !fileExists(filename);
+    if (file.size() < sizeof(journalMagic)) return true; // журнал не успели создать
+
+    const char* data = file.data();
+    if (std::memcmp(data, journalMagic, sizeof(journalMagic)) != 0) return false;
+
+    size_t pos = sizeof(journalMagic);
+    while (file.size() - pos >= recordHeaderSize) {
+        uint32_t crc, keyLength, valueLength;
+        std::memcpy(&crc, data + pos, 4);
+        std::memcpy(&keyLength, data + pos + 4, 4);
+        std::memcpy(&valueLength, data + pos + 8, 4);
+        char operation = data[pos + 12];
+
+        size_t bodyLength = recordHeaderSize - 4 + size_t(keyLength) + valueLength;
+        if (file.size() - pos - 4 < bodyLength) break;
+        if (crc32(data + pos + 4, bodyLength) != crc) break;
+
+        std::string_view english(data + pos + recordHeaderSize, keyLength);
+        std::string_view russian(english.data() + keyLength, valueLength);
+        if (operation == addOperation)
+            dict.insert_or_assign(english, russian);
+        else if (operation == removeOperation)
+            dict -= std::string(english);
+        else
+            break;
+        pos += 4 + bodyLength;
+    }
+    journalBytes = pos;
+    return true;
+}
+
+bool JournaledDictionary::close() {
+    if (journalFile < 0) return true;
+    bool committed = commit();
+    closeFile(journalFile);
+    journalFile = -1;
+    pending.clear();
+    return committed;
+}
+
+bool JournaledDictionary::isOpen() const {
+    return journalFile >= 0;
+}
+
+void JournaledDictionary::append(char operation, std::string_view english, std::string_view russian) {
+    size_t start = pending.size();
+    pending.resize(start + recordHeaderSize + english.size() + russian.size());
+    char* record = pending.data() + start;
+
+    uint32_t keyLength = static_cast<uint32_t>(english.size());
+    uint32_t valueLength = static_cast<uint32_t>(russian.size());
+    std::memcpy(record + 4, &keyLength, 4);
+    std::memcpy(record + 8, &valueLength, 4);
+    record[12] = operation;
+    std::memcpy(record + recordHeaderSize, english.data(), english.size());
+    if (!russian.empty()) // у записи удаления перевода нет
+        std::memcpy(record + recordHeaderSize + english.size(), russian.data(), russian.size());
+
+    uint32_t crc = crc32(record + 4, recordHeaderSize - 4 + english.size() + russian.size());
+    std::memcpy(record, &crc, 4);
+}
+
+// Ошибки фиксации и свёртки запоминаются в failed и видны через healthy()
+void JournaledDictionary::maybeFlush() {
+    if (pending.size() < groupCommitBytes) return;
+    if (commit() && compactionBytes && journalBytes >= compactionBytes)
+        compact();
+}
+
+JournaledDictionary& JournaledDictionary::operator+=(const std::pair<std::string, std::string>& words) {
+    dict.insert_or_assign(words.first, words.second);
+    if (isOpen()) {
+        append(addOperation, words.first, words.second);
+        maybeFlush();
+    }
+    return *this;
+}
+
+JournaledDictionary& JournaledDictionary::operator-=(const std::string& english) {
+    if (!dict.contains(english)) return *this;
+    dict -= english;
+    if (isOpen()) {
+        append(removeOperation, english, std::string_view());
+        maybeFlush();
+    }
+    return *this;
+}
+
+bool JournaledDictionary::commit() {
+    if (!isOpen()) return false;
+    if (pending.empty()) return true;
+    if (!writeAll(journalFile, pending.data(), pending.size()) || !syncFile(journalFile)) {
+        // Частично записанная группа отрезается, записи остаются в буфере для повтора
+        truncateFile(journalFile, journalBytes);
+        failed = true;
+        return false;
+    }
+    journalBytes += pending.size();
+    pending.clear();
+    return true;
+}
+
+bool JournaledDictionary::compact() {
+    if (!commit()) return false;
+
+    // Снимок пишется рядом и подменяет старый атомарным переименованием.
+    // Если он не записан целиком, старый снимок и журнал остаются нетронутыми.
+    const std::string temporary = snapshotPath + ".tmp";
+    if (!dict.freeze().save(temporary) || !syncPath(temporary) || !replaceFile(temporary, snapshotPath)) {
+        std::remove(temporary.c_str());
+        failed = true;
+        return false;
+    }
+    syncDirectoryOf(snapshotPath);
+
+    if (!truncateFile(journalFile, sizeof(journalMagic)) || !syncFile(journalFile)) {
+        failed = true;
+        return false;
+    }
+    journalBytes = sizeof(journalMagic);
+    return true;
+}
+
+std::string JournaledDictionary::operator[](std::string_view english) const {
+    std::optional<std::string_view> russian = dict.find(english);
+    return russian ? std::string(*russian) : std::string();
+}
+
+std::optional<std::string_view> JournaledDictionary::find(std::string_view english) const {
+    return dict.find(english);
+}
+
+bool JournaledDictionary::contains(std::string_view english) const {
+    return dict.contains(english);
+}
+
+size_t JournaledDictionary::count() const {
+    return dict.count();
+}
+
+const EnglishRussianDictionary& JournaledDictionary::dictionary() const {
+    return dict;
+}
+
+void JournaledDictionary::setGroupCommitBytes(size_t bytes) {
+    groupCommitBytes = bytes;
+}
+
+void JournaledDictionary::setCompactionBytes(size_t bytes) {
+    compactionBytes = bytes;
+}
+
+bool JournaledDictionary::healthy() const {
+    return !failed;
+}
+
+size_t JournaledDictionary::journalSize() const {
+    return journalBytes;
+}
+
+size_t JournaledDictionary::pendingSize() const {
+    return pending.size();
+}
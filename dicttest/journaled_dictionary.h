@@ -0,0 +1,86 @@
+#pragma once
+#ifndef JOURNALED_DICTIONARY_H
+#define JOURNALED_DICTIONARY_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "dictionary.h"
+
+// Словарь с журналом изменений. Состояние на диске — снимок (path.snapshot,
+// формат FrozenDictionary) и журнал (path.journal) с двоичными записями
+// операций += и -= после снимка. Каждая запись защищена CRC32, поэтому
+// оборванный при сбое хвост журнала распознаётся и отбрасывается.
+//
+// Записи копятся в буфере и пишутся одной группой с одним fsync: при commit(),
+// при переполнении группы и при закрытии. После сбоя теряются только
+// незафиксированные изменения. Когда журнал вырастает до порога, он сворачивается
+// в новый снимок (compact). Повторное применение журнала к снимку, уже
+// содержащему его изменения, даёт то же состояние, поэтому сбой между записью
+// снимка и очисткой журнала безопасен.
+class JournaledDictionary {
+private:
+    EnglishRussianDictionary dict;
+    std::string snapshotPath;
+    std::string journalPath;
+    int journalFile;
+    std::vector<char> pending;   // записи, ещё не отправленные на диск
+    size_t journalBytes;         // зафиксированный размер журнала
+    size_t groupCommitBytes;
+    size_t compactionBytes;
+    bool failed;                 // была неудачная фиксация или свёртка
+
+    void append(char operation, std::string_view english, std::string_view russian);
+    bool replay(const std::string& filename);
+    void maybeFlush();
+
+public:
+    static const size_t defaultGroupCommitBytes = 64 * 1024;
+    static const size_t defaultCompactionBytes = 64 * 1024 * 1024;
+
+    JournaledDictionary();
+    ~JournaledDictionary();
+
+    JournaledDictionary(const JournaledDictionary&) = delete;
+    JournaledDictionary& operator=(const JournaledDictionary&) = delete;
+
+    // Восстанавливает словарь из path.snapshot и path.journal (отсутствующие
+    // файлы считаются пустыми) и открывает журнал для дописывания
+    bool open(const std::string& path);
+    // Фиксирует накопленные изменения и закрывает журнал
+    bool close();
+    bool isOpen() const;
+
+    // Изменение сразу видно в словаре. Если оно запускает фиксацию группы или свёртку
+    // и та не удаётся, об этом сообщает healthy()
+    JournaledDictionary& operator+=(const std::pair<std::string, std::string>& words);
+    JournaledDictionary& operator-=(const std::string& english);
+
+    std::string operator[](std::string_view english) const;
+    std::optional<std::string_view> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+    size_t count() const;
+    // Только чтение: изменения в обход журнала не переживут перезапуск
+    const EnglishRussianDictionary& dictionary() const;
+
+    // Дописывает накопленные записи и делает fsync
+    bool commit();
+    // Записывает снимок текущего состояния и очищает журнал
+    bool compact();
+    // false, если с момента open() не удалась хотя бы одна фиксация или свёртка,
+    // в том числе запущенная из += и -=. Незафиксированные записи остаются в буфере,
+    // и успешный commit() делает их надёжными, но флаг держится до следующего open().
+    bool healthy() const;
+
+    // 0 — фиксировать каждое изменение отдельно
+    void setGroupCommitBytes(size_t bytes);
+    // 0 — сворачивать журнал только явным вызовом compact()
+    void setCompactionBytes(size_t bytes);
+    size_t journalSize() const;
+    size_t pendingSize() const;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef KEY_HASH_H
+#define KEY_HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Быстрый 64-битный хеш строки: по 8 байт за шаг и финальное перемешивание
+// из MurmurHash3, чтобы младшие и старшие биты были одинаково случайны
+inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t hashKey(std::string_view key) {
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+    const char* data = key.data();
+    size_t length = key.size();
+    uint64_t h = length * multiplier;
+    while (length >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        h = (h ^ mixHash(word)) * multiplier;
+        data += 8;
+        length -= 8;
+    }
+    if (length) {
+        uint64_t word = 0;
+        std::memcpy(&word, data, length);
+        h = (h ^ mixHash(word)) * multiplier;
+    }
+    return mixHash(h);
+}
+
+#endif
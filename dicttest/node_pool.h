@@ -0,0 +1,120 @@
+#pragma once
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Пул узлов фиксированного размера: память выделяется блоками (slab),
+// освобождённые ячейки переиспользуются через список свободных,
+// а release() возвращает всю память за O(число блоков).
+template <typename T>
+class NodePool {
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static const size_t firstChunkSize = 64;
+    static const size_t maxChunkSize = 16384;
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    Slot* freeList;
+    size_t used;      // занятых ячеек в последнем блоке
+    size_t capacity;  // размер последнего блока
+    size_t live;
+    size_t reserved;  // ячеек во всех блоках
+
+    Slot* grab() {
+        if (freeList) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            return slot;
+        }
+        if (used == capacity) {
+            capacity = capacity ? (capacity < maxChunkSize ? capacity * 2 : maxChunkSize) : firstChunkSize;
+            chunks.emplace_back(new Slot[capacity]);
+            reserved += capacity;
+            used = 0;
+        }
+        return &chunks.back()[used++];
+    }
+
+public:
+    NodePool() : freeList(nullptr), used(0), capacity(0), live(0), reserved(0) {}
+    ~NodePool() { release(); }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    // Перемещение передаёт блоки целиком, объекты остаются на своих местах
+    NodePool(NodePool&& other) noexcept
+        : chunks(std::move(other.chunks)), freeList(other.freeList), used(other.used),
+          capacity(other.capacity), live(other.live), reserved(other.reserved) {
+        other.chunks.clear();
+        other.freeList = nullptr;
+        other.used = 0;
+        other.capacity = 0;
+        other.live = 0;
+        other.reserved = 0;
+    }
+
+    NodePool& operator=(NodePool&& other) noexcept {
+        if (this != &other) {
+            release();
+            chunks.swap(other.chunks);
+            std::swap(freeList, other.freeList);
+            std::swap(used, other.used);
+            std::swap(capacity, other.capacity);
+            std::swap(live, other.live);
+            std::swap(reserved, other.reserved);
+        }
+        return *this;
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        Slot* slot = grab();
+        T* object;
+        try {
+            object = new (slot->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            slot->next = freeList;
+            freeList = slot;
+            throw;
+        }
+        live++;
+        return object;
+    }
+
+    // Вызывает деструктор и кладёт ячейку в список свободных
+    void destroy(T* object) {
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = freeList;
+        freeList = slot;
+        live--;
+    }
+
+    // Освобождает все блоки разом. Деструкторы живых объектов не вызываются —
+    // вызывающий код должен сделать это сам (или объекты тривиальны).
+    void release() {
+        chunks.clear();
+        freeList = nullptr;
+        used = 0;
+        capacity = 0;
+        live = 0;
+        reserved = 0;
+    }
+
+    size_t liveCount() const { return live; }
+    size_t chunkCount() const { return chunks.size(); }
+    size_t memoryUsage() const { return reserved * sizeof(Slot); }
+};
+
+#endif
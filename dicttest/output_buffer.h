@@ -0,0 +1,59 @@
+#pragma once
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Буфер вывода большого размера поверх потока: мелкие куски копируются
+// в буфер и уходят в поток одной записью, когда он заполняется.
+// Куски больше буфера пишутся напрямую.
+class OutputBuffer {
+private:
+    std::ostream& out;
+    std::vector<char> buffer;
+    size_t used;
+
+public:
+    static const size_t defaultCapacity = 1 << 20;
+
+    explicit OutputBuffer(std::ostream& stream, size_t capacity = defaultCapacity)
+        : out(stream), buffer(capacity), used(0) {}
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void write(const void* data, size_t length) {
+        if (length > buffer.size() - used) {
+            flush();
+            if (length >= buffer.size()) {
+                out.write(static_cast<const char*>(data), static_cast<std::streamsize>(length));
+                return;
+            }
+        }
+        std::memcpy(buffer.data() + used, data, length);
+        used += length;
+    }
+
+    void write(std::string_view text) { write(text.data(), text.size()); }
+
+    void put(char c) {
+        if (used == buffer.size()) flush();
+        buffer[used++] = c;
+    }
+
+    // Возвращает состояние потока после записи
+    bool flush() {
+        if (used) {
+            out.write(buffer.data(), static_cast<std::streamsize>(used));
+            used = 0;
+        }
+        return static_cast<bool>(out);
+    }
+};
+
+#endif
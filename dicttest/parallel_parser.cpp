@@ -0,0 +1,130 @@
+﻿#include "parallel_parser.h"
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <thread>
+
+namespace {
+
+using Pair = std::pair<std::string_view, std::string_view>;
+
+const char* lineEnd(const char* pos, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    return newline ? newline : end;
+}
+
+const char* nextLine(const char* pos, const char* end) {
+    const char* stop = lineEnd(pos, end);
+    return stop < end ? stop + 1 : end;
+}
+
+size_t countLines(const char* pos, const char* end) {
+    size_t lines = 0;
+    while (pos < end) {
+        pos = nextLine(pos, end);
+        lines++;
+    }
+    return lines;
+}
+
+// Пары, у которых строка со словом начинается в [from, to); перевод может
+// заканчиваться за to. Результат сортируется, повторы внутри куска схлопываются.
+void parseChunk(const char* from, const char* to, const char* end, std::vector<Pair>& out) {
+    const char* pos = from;
+    while (pos < to) {
+        const char* englishEnd = lineEnd(pos, end);
+        if (englishEnd == end) break; // слово без перевода в конце файла
+        const char* russian = englishEnd + 1;
+        if (russian >= end) break;
+        const char* russianEnd = lineEnd(russian, end);
+        out.emplace_back(std::string_view(pos, englishEnd - pos), std::string_view(russian, russianEnd - russian));
+        pos = russianEnd < end ? russianEnd + 1 : end;
+    }
+
+    // Устойчивая сортировка сохраняет порядок повторов, последний и побеждает
+    std::stable_sort(out.begin(), out.end(), [](const Pair& a, const Pair& b) { return a.first < b.first; });
+    size_t kept = 0;
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (i + 1 < out.size() && out[i].first == out[i + 1].first) continue;
+        out[kept++] = out[i];
+    }
+    out.resize(kept);
+}
+
+}
+
+std::vector<Pair> parseSortedPairs(const char* data, size_t size, unsigned threads) {
+    if (!data || size == 0) return std::vector<Pair>();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* end = data + size;
+    // Слишком мелкие куски не окупают потоки
+    threads = static_cast<unsigned>(std::min<size_t>(threads, size / 65536 + 1));
+
+    // Границы кусков сдвигаются на начало строки
+    std::vector<const char*> bounds(threads + 1);
+    bounds[0] = data;
+    bounds[threads] = end;
+    for (unsigned i = 1; i < threads; ++i) {
+        const char* guess = data + size / threads * i;
+        bounds[i] = std::max(bounds[i - 1], guess > data && guess[-1] == '\n' ? guess : nextLine(guess, end));
+    }
+
+    // Первый проход: число строк в каждом куске, чтобы узнать чётность начала
+    std::vector<size_t> lines(threads);
+    {
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([&, i]() { lines[i] = countLines(bounds[i], bounds[i + 1]); });
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    // Кусок, начинающийся с нечётной строки, начинается с перевода предыдущей пары
+    std::vector<const char*> starts(threads);
+    size_t lineIndex = 0;
+    for (unsigned i = 0; i < threads; ++i) {
+        starts[i] = bounds[i];
+        if (lineIndex % 2 == 1 && starts[i] < end)
+            starts[i] = nextLine(starts[i], end);
+        lineIndex += lines[i];
+    }
+
+    // Второй проход: разбор и сортировка кусков
+    std::vector<std::vector<Pair>> parts(threads);
+    {
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([&, i]() { parseChunk(starts[i], bounds[i + 1], end, parts[i]); });
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+    if (threads == 1) return std::move(parts[0]);
+
+    // k-путевое слияние; при равных словах побеждает кусок с большим номером
+    using Cursor = std::pair<unsigned, size_t>;
+    auto after = [&parts](const Cursor& a, const Cursor& b) {
+        int cmp = parts[a.first][a.second].first.compare(parts[b.first][b.second].first);
+        return cmp != 0 ? cmp > 0 : a.first < b.first;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(after)> heap(after);
+    size_t total = 0;
+    for (unsigned i = 0; i < threads; ++i) {
+        total += parts[i].size();
+        if (!parts[i].empty())
+            heap.push(Cursor(i, 0));
+    }
+
+    std::vector<Pair> merged;
+    merged.reserve(total);
+    while (!heap.empty()) {
+        Cursor top = heap.top();
+        heap.pop();
+        const Pair& pair = parts[top.first][top.second];
+        // Первым выходит вариант из самого позднего куска, остальные пропускаются
+        if (merged.empty() || merged.back().first != pair.first)
+            merged.push_back(pair);
+        if (top.second + 1 < parts[top.first].size())
+            heap.push(Cursor(top.first, top.second + 1));
+    }
+    return merged;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Разбирает текст формата словаря (строка со словом, строка с переводом)
+// несколькими потоками. Возвращает пары, указывающие в исходный текст,
+// отсортированные по слову; из повторов остаётся последнее по файлу,
+// как при последовательных operator+=. Строки режутся так же, как std::getline.
+// threads == 0 — по числу ядер.
+std::vector<std::pair<std::string_view, std::string_view>> parseSortedPairs(
+    const char* data, size_t size, unsigned threads = 0);
+
+#endif
@@ -0,0 +1,323 @@
+﻿#include "persistent_dictionary.h"
+#include "dictionary.h"
+#include "mapped_file.h"
+#include "parallel_parser.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+PersistentDictionary::Snapshot::Snapshot() : root(nullptr), size(0) {}
+
+// Забирает уже учтённую ссылку на node
+PersistentDictionary::Snapshot::Snapshot(Node* node, size_t count) : root(node), size(count) {}
+
+PersistentDictionary::Snapshot::Snapshot(const Snapshot& other)
+    : root(retain(other.root)), size(other.size) {
+}
+
+PersistentDictionary::Snapshot::Snapshot(Snapshot&& other) noexcept : root(other.root), size(other.size) {
+    other.root = nullptr;
+    other.size = 0;
+}
+
+PersistentDictionary::Snapshot& PersistentDictionary::Snapshot::operator=(const Snapshot& other) {
+    Node* previous = root;
+    root = retain(other.root);
+    size = other.size;
+    release(previous);
+    return *this;
+}
+
+PersistentDictionary::Snapshot& PersistentDictionary::Snapshot::operator=(Snapshot&& other) noexcept {
+    if (this != &other) {
+        release(root);
+        root = other.root;
+        size = other.size;
+        other.root = nullptr;
+        other.size = 0;
+    }
+    return *this;
+}
+
+PersistentDictionary::Snapshot::~Snapshot() {
+    release(root);
+}
+
+const PersistentDictionary::Node* PersistentDictionary::Snapshot::findNode(std::string_view english) const {
+    const Node* node = root;
+    while (node) {
+        int cmp = english.compare(node->english);
+        if (cmp == 0) return node;
+        node = cmp < 0 ? node->left : node->right;
+    }
+    return nullptr;
+}
+
+std::string PersistentDictionary::Snapshot::operator[](std::string_view english) const {
+    const Node* node = findNode(english);
+    return node ? node->russian : std::string();
+}
+
+std::optional<std::string_view> PersistentDictionary::Snapshot::find(std::string_view english) const {
+    const Node* node = findNode(english);
+    if (!node) return std::nullopt;
+    return std::string_view(node->russian);
+}
+
+bool PersistentDictionary::Snapshot::contains(std::string_view english) const {
+    return findNode(english) != nullptr;
+}
+
+size_t PersistentDictionary::Snapshot::count() const {
+    return size;
+}
+
+bool PersistentDictionary::Snapshot::validate() const {
+    size_t nodes = 0;
+    return checkSubtree(root, nullptr, nullptr, nodes) >= 0 && nodes == size;
+}
+
+PersistentDictionary::PersistentDictionary() {}
+
+PersistentDictionary::PersistentDictionary(const EnglishRussianDictionary& dict) {
+    std::vector<std::pair<std::string_view, std::string_view>> sorted;
+    sorted.reserve(dict.count());
+    dict.forEach([&sorted](std::string_view english, std::string_view russian) {
+        sorted.emplace_back(english, russian);
+    });
+    assign(sorted);
+}
+
+void PersistentDictionary::assign(const std::vector<std::pair<std::string_view, std::string_view>>& sorted) {
+    current = Snapshot(build(sorted, 0, sorted.size()), sorted.size());
+}
+
+bool PersistentDictionary::load(const std::string& filename, unsigned threads) {
+    MappedFile file;
+    if (!file.open(filename)) return false;
+    assign(parseSortedPairs(file.data(), file.size(), threads));
+    return true;
+}
+
+PersistentDictionary::Node* PersistentDictionary::retain(Node* node) {
+    if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+    return node;
+}
+
+void PersistentDictionary::release(Node* node) {
+    while (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        release(node->left);
+        Node* right = node->right;
+        delete node;
+        node = right;
+    }
+}
+
+// Делает узел собственным для вызывающего: если на него ссылается кто-то ещё,
+// вместо него возвращается копия, а детей начинают делить копия и оригинал.
+// Забирает ссылку на node и возвращает ссылку на результат.
+PersistentDictionary::Node* PersistentDictionary::own(Node* node) {
+    if (node->refs.load(std::memory_order_acquire) == 1) return node;
+    Node* copy = new Node(node->english, node->russian);
+    copy->height = node->height;
+    copy->left = retain(node->left);
+    copy->right = retain(node->right);
+    release(node);
+    return copy;
+}
+
+int PersistentDictionary::heightOf(const Node* node) {
+    return node ? node->height : 0;
+}
+
+void PersistentDictionary::updateHeight(Node* node) {
+    node->height = 1 + std::max(heightOf(node->left), heightOf(node->right));
+}
+
+// Повороты получают собственный узел и сами делают собственным поднимаемого ребёнка
+PersistentDictionary::Node* PersistentDictionary::rotateLeft(Node* node) {
+    Node* rightChild = own(node->right);
+    node->right = rightChild->left;
+    rightChild->left = node;
+    updateHeight(node);
+    updateHeight(rightChild);
+    return rightChild;
+}
+
+PersistentDictionary::Node* PersistentDictionary::rotateRight(Node* node) {
+    Node* leftChild = own(node->left);
+    node->left = leftChild->right;
+    leftChild->right = node;
+    updateHeight(node);
+    updateHeight(leftChild);
+    return leftChild;
+}
+
+PersistentDictionary::Node* PersistentDictionary::balance(Node* node) {
+    updateHeight(node);
+    int skew = heightOf(node->left) - heightOf(node->right);
+    if (skew > 1) {
+        if (heightOf(node->left->left) < heightOf(node->left->right))
+            node->left = rotateLeft(own(node->left));
+        return rotateRight(node);
+    }
+    if (skew < -1) {
+        if (heightOf(node->right->right) < heightOf(node->right->left))
+            node->right = rotateRight(own(node->right));
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+// Забирает ссылку на поддерево и возвращает ссылку на его новую версию
+PersistentDictionary::Node* PersistentDictionary::insert(Node* node, std::string_view english,
+                                                         std::string_view russian) {
+    if (!node) return new Node(english, russian);
+    node = own(node);
+    int cmp = english.compare(node->english);
+    if (cmp == 0) {
+        node->russian.assign(russian.data(), russian.size());
+        return node;
+    }
+    if (cmp < 0)
+        node->left = insert(node->left, english, russian);
+    else
+        node->right = insert(node->right, english, russian);
+    return balance(node);
+}
+
+// Слово должно быть в поддереве: иначе путь копировался бы впустую
+PersistentDictionary::Node* PersistentDictionary::erase(Node* node, std::string_view english) {
+    node = own(node);
+    int cmp = english.compare(node->english);
+    if (cmp < 0) {
+        node->left = erase(node->left, english);
+    }
+    else if (cmp > 0) {
+        node->right = erase(node->right, english);
+    }
+    else if (node->left && node->right) {
+        // Место удаляемого занимает наименьшее слово правого поддерева
+        const Node* next = node->right;
+        while (next->left)
+            next = next->left;
+        node->english = next->english;
+        node->russian = next->russian;
+        node->right = erase(node->right, node->english);
+    }
+    else {
+        Node* child = node->left ? node->left : node->right;
+        node->left = node->right = nullptr;
+        release(node);
+        return child;
+    }
+    return balance(node);
+}
+
+PersistentDictionary::Node* PersistentDictionary::build(
+    const std::vector<std::pair<std::string_view, std::string_view>>& sorted, size_t lo, size_t hi) {
+    if (lo >= hi) return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    Node* node = new Node(sorted[mid].first, sorted[mid].second);
+    node->left = build(sorted, lo, mid);
+    node->right = build(sorted, mid + 1, hi);
+    updateHeight(node);
+    return node;
+}
+
+PersistentDictionary& PersistentDictionary::operator+=(const std::pair<const char*, const char*>& words) {
+    return *this += std::make_pair(std::string(words.first), std::string(words.second));
+}
+
+PersistentDictionary& PersistentDictionary::operator+=(const std::pair<std::string, std::string>& words) {
+    std::optional<std::string_view> existing = current.find(words.first);
+    if (existing && *existing == words.second) return *this;
+    current.root = insert(current.root, words.first, words.second);
+    if (!existing) current.size++;
+    return *this;
+}
+
+PersistentDictionary& PersistentDictionary::operator-=(const char* english) {
+    return *this -= std::string(english);
+}
+
+PersistentDictionary& PersistentDictionary::operator-=(const std::string& english) {
+    if (!current.contains(english)) return *this;
+    current.root = erase(current.root, english);
+    current.size--;
+    return *this;
+}
+
+std::string PersistentDictionary::operator[](std::string_view english) const {
+    return current[english];
+}
+
+std::optional<std::string_view> PersistentDictionary::find(std::string_view english) const {
+    return current.find(english);
+}
+
+bool PersistentDictionary::contains(std::string_view english) const {
+    return current.contains(english);
+}
+
+size_t PersistentDictionary::count() const {
+    return current.count();
+}
+
+void PersistentDictionary::clear() {
+    current = Snapshot();
+}
+
+PersistentDictionary::Snapshot PersistentDictionary::snapshot() const {
+    return current;
+}
+
+void PersistentDictionary::restore(const Snapshot& version) {
+    current = version;
+}
+
+size_t PersistentDictionary::memoryUsage(const std::vector<Snapshot>& versions) {
+    // Короткие строки хранятся внутри объекта std::string и отдельной памяти не занимают
+    auto heapBytes = [](const std::string& text) -> size_t {
+        const char* object = reinterpret_cast<const char*>(&text);
+        std::less<const char*> before;
+        bool embedded = !before(text.data(), object) && before(text.data(), object + sizeof(text));
+        return embedded ? 0 : text.capacity() + 1;
+    };
+
+    std::unordered_set<const Node*> seen;
+    std::vector<const Node*> stack;
+    size_t bytes = 0;
+    for (const Snapshot& version : versions) {
+        if (version.root) stack.push_back(version.root);
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            // Общее поддерево уже посчитано целиком
+            if (!seen.insert(node).second) continue;
+            bytes += sizeof(Node) + heapBytes(node->english) + heapBytes(node->russian);
+            if (node->left) stack.push_back(node->left);
+            if (node->right) stack.push_back(node->right);
+        }
+    }
+    return bytes;
+}
+
+bool PersistentDictionary::validate() const {
+    return current.validate();
+}
+
+// Высота поддерева или -1, если нарушен порядок ключей, высота или баланс
+int PersistentDictionary::checkSubtree(const Node* node, const std::string* low, const std::string* high,
+                                       size_t& count) {
+    if (!node) return 0;
+    if (node->refs.load() == 0) return -1;
+    if ((low && node->english <= *low) || (high && node->english >= *high)) return -1;
+    int leftHeight = checkSubtree(node->left, low, &node->english, count);
+    int rightHeight = checkSubtree(node->right, &node->english, high, count);
+    if (leftHeight < 0 || rightHeight < 0) return -1;
+    if (leftHeight - rightHeight > 1 || rightHeight - leftHeight > 1) return -1;
+    if (node->height != 1 + std::max(leftHeight, rightHeight)) return -1;
+    count++;
+    return node->height;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#ifndef PERSISTENT_DICTIONARY_H
+#define PERSISTENT_DICTIONARY_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class EnglishRussianDictionary;
+
+// Версионный словарь на AVL-дереве с копированием пути. Изменение копирует
+// только O(log n) узлов от корня до места правки, остальные узлы общие
+// со старыми версиями. snapshot() за O(1) возвращает неизменяемую версию,
+// которая продолжает читаться, пока словарь меняется дальше.
+//
+// Узлы считают ссылки на себя атомарно и удаляются вместе с последней
+// версией, которая их видит. Узел, на который больше никто не ссылается,
+// правится на месте, поэтому без снимков изменения копирований не делают.
+// Снимки можно читать, копировать и удалять из других потоков; сам словарь
+// меняется из одного потока.
+class PersistentDictionary {
+private:
+    struct Node {
+        std::atomic<uint32_t> refs;
+        int height;
+        Node* left;
+        Node* right;
+        std::string english;
+        std::string russian;
+
+        Node(std::string_view eng, std::string_view rus)
+            : refs(1), height(1), left(nullptr), right(nullptr), english(eng), russian(rus) {}
+    };
+
+public:
+    // Неизменяемая версия словаря. Представления переводов действительны,
+    // пока жив снимок.
+    class Snapshot {
+    private:
+        friend class PersistentDictionary;
+        Node* root;
+        size_t size;
+
+        Snapshot(Node* node, size_t count);
+        const Node* findNode(std::string_view english) const;
+
+    public:
+        Snapshot();
+        Snapshot(const Snapshot& other);
+        Snapshot(Snapshot&& other) noexcept;
+        Snapshot& operator=(const Snapshot& other);
+        Snapshot& operator=(Snapshot&& other) noexcept;
+        ~Snapshot();
+
+        std::string operator[](std::string_view english) const;
+        std::optional<std::string_view> find(std::string_view english) const;
+        bool contains(std::string_view english) const;
+        size_t count() const;
+
+        // Обход в порядке возрастания ключей: visit(english, russian)
+        template <typename Visitor>
+        void forEach(Visitor visit) const;
+
+        // Проверка порядка ключей, высот и баланса (для тестов)
+        bool validate() const;
+    };
+
+    PersistentDictionary();
+    explicit PersistentDictionary(const EnglishRussianDictionary& dict);
+    // Копия стоит O(1): версии делят все узлы до первого изменения
+    PersistentDictionary(const PersistentDictionary& other) = default;
+    PersistentDictionary& operator=(const PersistentDictionary& other) = default;
+
+    PersistentDictionary& operator+=(const std::pair<const char*, const char*>& words);
+    PersistentDictionary& operator+=(const std::pair<std::string, std::string>& words);
+    PersistentDictionary& operator-=(const char* english);
+    PersistentDictionary& operator-=(const std::string& english);
+    std::string operator[](std::string_view english) const;
+
+    // Представление действительно до следующего изменения словаря
+    std::optional<std::string_view> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+    size_t count() const;
+    void clear();
+    bool load(const std::string& filename, unsigned threads = 0);
+
+    // Текущая версия за O(1)
+    Snapshot snapshot() const;
+    // Возврат к сохранённой версии за O(1)
+    void restore(const Snapshot& version);
+
+    // Байт, занятых узлами и строками всех перечисленных версий; общие узлы
+    // считаются один раз
+    static size_t memoryUsage(const std::vector<Snapshot>& versions);
+
+    template <typename Visitor>
+    void forEach(Visitor visit) const;
+
+    bool validate() const;
+
+private:
+    Snapshot current;
+
+    static Node* retain(Node* node);
+    static void release(Node* node);
+    static Node* own(Node* node);
+    static int heightOf(const Node* node);
+    static void updateHeight(Node* node);
+    static Node* rotateLeft(Node* node);
+    static Node* rotateRight(Node* node);
+    static Node* balance(Node* node);
+    static Node* insert(Node* node, std::string_view english, std::string_view russian);
+    static Node* erase(Node* node, std::string_view english);
+    static Node* build(const std::vector<std::pair<std::string_view, std::string_view>>& sorted,
+                       size_t lo, size_t hi);
+    static int checkSubtree(const Node* node, const std::string* low, const std::string* high,
+                            size_t& count);
+
+    template <typename Visitor>
+    static void visitSubtree(const Node* node, Visitor& visit);
+
+    void assign(const std::vector<std::pair<std::string_view, std::string_view>>& sorted);
+};
+
+template <typename Visitor>
+void PersistentDictionary::visitSubtree(const Node* node, Visitor& visit) {
+    while (node) {
+        visitSubtree(node->left, visit);
+        visit(std::string_view(node->english), std::string_view(node->russian));
+        node = node->right;
+    }
+}
+
+template <typename Visitor>
+void PersistentDictionary::Snapshot::forEach(Visitor visit) const {
+    visitSubtree(root, visit);
+}
+
+template <typename Visitor>
+void PersistentDictionary::forEach(Visitor visit) const {
+    current.forEach(visit);
+}
+
+#endif
@@ -0,0 +1,79 @@
+﻿#include "sharded_dictionary.h"
+#include <functional>
+
+ShardedDictionary::ShardedDictionary(size_t shards)
+    : shards(new Shard[shards ? shards : 1]), shardCount(shards ? shards : 1) {
+}
+
+size_t ShardedDictionary::shardOf(std::string_view english) const {
+    return std::hash<std::string_view>()(english) % shardCount;
+}
+
+ShardedDictionary& ShardedDictionary::operator+=(const std::pair<std::string, std::string>& words) {
+    Shard& shard = shards[shardOf(words.first)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.dict += words;
+    return *this;
+}
+
+ShardedDictionary& ShardedDictionary::operator-=(const std::string& english) {
+    Shard& shard = shards[shardOf(english)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.dict -= english;
+    return *this;
+}
+
+std::string ShardedDictionary::operator[](std::string_view english) const {
+    std::optional<std::string> russian = find(english);
+    return russian ? *russian : std::string();
+}
+
+std::optional<std::string> ShardedDictionary::find(std::string_view english) const {
+    Shard& shard = shards[shardOf(english)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::optional<std::string_view> russian = shard.dict.find(english);
+    if (!russian) return std::nullopt;
+    return std::string(*russian);
+}
+
+bool ShardedDictionary::contains(std::string_view english) const {
+    Shard& shard = shards[shardOf(english)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.dict.contains(english);
+}
+
+// Сумма по сегментам; при одновременной записи это мгновенный снимок каждого сегмента
+size_t ShardedDictionary::count() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shardCount; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        total += shards[i].dict.count();
+    }
+    return total;
+}
+
+void ShardedDictionary::add(const std::vector<std::pair<std::string, std::string>>& words) {
+    std::vector<std::vector<size_t>> groups(shardCount);
+    for (size_t i = 0; i < words.size(); ++i)
+        groups[shardOf(words[i].first)].push_back(i);
+
+    for (size_t s = 0; s < shardCount; ++s) {
+        if (groups[s].empty()) continue;
+        std::lock_guard<std::mutex> lock(shards[s].mutex);
+        for (size_t index : groups[s])
+            shards[s].dict += words[index];
+    }
+}
+
+void ShardedDictionary::remove(const std::vector<std::string>& words) {
+    std::vector<std::vector<size_t>> groups(shardCount);
+    for (size_t i = 0; i < words.size(); ++i)
+        groups[shardOf(words[i])].push_back(i);
+
+    for (size_t s = 0; s < shardCount; ++s) {
+        if (groups[s].empty()) continue;
+        std::lock_guard<std::mutex> lock(shards[s].mutex);
+        for (size_t index : groups[s])
+            shards[s].dict -= words[index];
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef SHARDED_DICTIONARY_H
+#define SHARDED_DICTIONARY_H
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "dictionary.h"
+
+// Словарь для многопоточной записи: ключи распределяются хешем по N деревьям,
+// каждое под своей блокировкой, поэтому потоки, работающие с разными
+// сегментами, не мешают друг другу.
+class ShardedDictionary {
+private:
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        EnglishRussianDictionary dict;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t shardCount;
+
+    size_t shardOf(std::string_view english) const;
+
+public:
+    explicit ShardedDictionary(size_t shards = 16);
+
+    ShardedDictionary(const ShardedDictionary&) = delete;
+    ShardedDictionary& operator=(const ShardedDictionary&) = delete;
+
+    ShardedDictionary& operator+=(const std::pair<std::string, std::string>& words);
+    ShardedDictionary& operator-=(const std::string& english);
+    std::string operator[](std::string_view english) const;
+    std::optional<std::string> find(std::string_view english) const;
+    bool contains(std::string_view english) const;
+    size_t count() const;
+
+    // Пакетные операции: слова группируются по сегментам, и каждый сегмент
+    // блокируется один раз на весь пакет. Порядок внутри сегмента сохраняется.
+    void add(const std::vector<std::pair<std::string, std::string>>& words);
+    void remove(const std::vector<std::string>& words);
+
+    // Обход всех сегментов в общем порядке возрастания ключей: visit(english, russian).
+    // На время обхода блокируются все сегменты.
+    template <typename Visitor>
+    void forEach(Visitor visit) const;
+
+};
+
+template <typename Visitor>
+void ShardedDictionary::forEach(Visitor visit) const {
+    // Блокировки берутся всегда в порядке номеров сегментов
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i)
+        locks.emplace_back(shards[i].mutex);
+
+    // k-путевое слияние: в куче по одному текущему итератору каждого сегмента
+    using Cursor = std::pair<EnglishRussianDictionary::const_iterator, size_t>;
+    auto greater = [](const Cursor& a, const Cursor& b) {
+        return a.first.english() > b.first.english();
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < shardCount; ++i)
+        if (shards[i].dict.count())
+            heap.push(Cursor(shards[i].dict.begin(), i));
+    while (!heap.empty()) {
+        Cursor top = heap.top();
+        heap.pop();
+        visit(top.first.english(), top.first.russian());
+        if (++top.first != shards[top.second].dict.end())
+            heap.push(top);
+    }
+}
+
+#endif
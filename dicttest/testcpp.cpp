@@ -1,8 +1,24 @@
 #include "dictionary.h"
+#include "frozen_dictionary.h"
+#include "btree_dictionary.h"
+#include "concurrent_dictionary.h"
+#include "sharded_dictionary.h"
+#include "parallel_parser.h"
+#include "journaled_dictionary.h"
+#include "compressed_dictionary.h"
+#include "edit_distance.h"
+#include "persistent_dictionary.h"
 #include <gtest/gtest.h>
+#include <filesystem>
 #include <fstream>
 #include <cstdio>
 #include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
 
 class DictionaryTest : public ::testing::Test {
 protected:
@@ -306,6 +322,1453 @@ TEST_F(DictionaryTest, StressTest) {
     }
 }
 
+TEST_F(DictionaryTest, ClearAndReuse) {
+    for (int i = 0; i < 1000; ++i)
+        dict += std::make_pair("w" + std::to_string(i), "с" + std::to_string(i));
+    EXPECT_EQ(dict.count(), 1000);
+
+    dict.clear();
+    EXPECT_EQ(dict.count(), 0);
+    const EnglishRussianDictionary& const_dict = dict;
+    EXPECT_EQ(const_dict["w1"], "");
+
+    dict += std::make_pair("after", "после");
+    EXPECT_EQ(dict.count(), 1);
+    EXPECT_EQ(dict["after"], "после");
+}
+
+TEST(NodePoolTest, ReusesFreedSlots) {
+    NodePool<std::string> pool;
+    std::string* a = pool.create("first");
+    std::string* b = pool.create("second");
+    EXPECT_EQ(pool.liveCount(), 2);
+    EXPECT_EQ(pool.chunkCount(), 1);
+
+    pool.destroy(a);
+    std::string* c = pool.create("third");
+    EXPECT_EQ(c, a); // ячейка из списка свободных
+    EXPECT_EQ(*b, "second");
+    EXPECT_EQ(*c, "third");
+
+    pool.destroy(b);
+    pool.destroy(c);
+    EXPECT_EQ(pool.liveCount(), 0);
+}
+
+TEST_F(DictionaryTest, LoadMappedFile) {
+    const std::string filename = "test_mapped.txt";
+    createTestFile(filename, "apple\nяблоко\nbanana\nбанан\napple\nяблоня\ncherry\nвишня");
+
+    EXPECT_TRUE(dict.load(filename, EnglishRussianDictionary::LoadMode::Mapped));
+    EXPECT_EQ(dict.count(), 3);
+    const EnglishRussianDictionary& const_dict = dict;
+    EXPECT_EQ(const_dict["apple"], "яблоня"); // последнее вхождение побеждает
+    EXPECT_EQ(const_dict["cherry"], "вишня"); // строка без завершающего '\n'
+
+    // Изменение перевода не трогает файл
+    dict["banana"] = "бананы";
+    EXPECT_EQ(dict["banana"], "бананы");
+    dict += std::make_pair("date", "финик");
+    dict -= "apple";
+    EXPECT_EQ(dict.count(), 3);
+    EXPECT_EQ(const_dict["apple"], "");
+
+    std::remove(filename.c_str());
+}
+
+TEST_F(DictionaryTest, LoadMappedEmptyAndMissingFile) {
+    const std::string filename = "empty_mapped.txt";
+    createTestFile(filename, "");
+
+    EXPECT_TRUE(dict.load(filename, EnglishRussianDictionary::LoadMode::Mapped));
+    EXPECT_EQ(dict.count(), 0);
+    EXPECT_FALSE(dict.load("non_existent_file.txt", EnglishRussianDictionary::LoadMode::Mapped));
+
+    std::remove(filename.c_str());
+}
+
+TEST_F(DictionaryTest, AssignBuildsValidTree) {
+    for (size_t n = 0; n < 70; ++n) {
+        std::vector<std::pair<std::string, std::string>> words;
+        for (size_t i = 0; i < n; ++i)
+            words.push_back(std::make_pair("k" + std::to_string(1000 + i), "з" + std::to_string(i)));
+
+        dict.assign(words);
+        EXPECT_EQ(dict.count(), n);
+        EXPECT_TRUE(dict.validate());
+
+        // Дерево после пакетной сборки должно выдерживать обычные операции
+        dict += std::make_pair("a", "а");
+        dict -= "k1000";
+        EXPECT_TRUE(dict.validate());
+    }
+}
+
+TEST_F(DictionaryTest, AssignUnsortedWithDuplicates) {
+    std::vector<std::pair<std::string, std::string>> words = {
+        {"pear", "груша"}, {"apple", "яблоко"}, {"pear", "грушa2"},
+        {"fig", "инжир"}, {"apple", "яблоня"}, {"pear", "груша3"}};
+
+    dict.assign(words);
+    EXPECT_EQ(dict.count(), 3);
+    EXPECT_TRUE(dict.validate());
+    EXPECT_EQ(dict["apple"], "яблоня");
+    EXPECT_EQ(dict["pear"], "груша3");
+    EXPECT_EQ(dict["fig"], "инжир");
+}
+
+TEST_F(DictionaryTest, ValidAfterManyOperations) {
+    for (int i = 0; i < 500; ++i)
+        dict += std::make_pair(std::to_string(i * 7919 % 1000), "x");
+    EXPECT_TRUE(dict.validate());
+    for (int i = 0; i < 500; i += 3)
+        dict -= std::to_string(i * 7919 % 1000);
+    EXPECT_TRUE(dict.validate());
+}
+
+TEST_F(DictionaryTest, StringViewLookup) {
+    dict += std::make_pair("sun", "солнце");
+    dict += std::make_pair("moon", "луна");
+    dict["star"] = "";
+
+    std::string buffer = "sunrise";
+    std::string_view key(buffer.data(), 3);
+    ASSERT_TRUE(dict.find(key).has_value());
+    EXPECT_EQ(*dict.find(key), "солнце");
+    EXPECT_TRUE(dict.contains("moon"));
+    EXPECT_FALSE(dict.contains("sunrise"));
+    EXPECT_FALSE(dict.find("planet").has_value());
+
+    // Пустой перевод отличается от отсутствующего слова
+    ASSERT_TRUE(dict.find("star").has_value());
+    EXPECT_TRUE(dict.find("star")->empty());
+    EXPECT_EQ(dict.count(), 3);
+}
+
+TEST_F(DictionaryTest, LookupBatchMatchesSingleLookups) {
+    for (int i = 0; i < 300; i += 2)
+        dict += std::make_pair("w" + std::to_string(i), "с" + std::to_string(i));
+
+    std::vector<std::string> words;
+    for (int i = 0; i < 100; ++i)
+        words.push_back("w" + std::to_string(i * 3));
+    std::vector<std::string_view> keys(words.begin(), words.end());
+
+    std::vector<std::optional<std::string_view>> results = dict.lookupBatch(keys);
+    ASSERT_EQ(results.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        EXPECT_EQ(results[i], dict.find(keys[i])) << keys[i];
+
+    EnglishRussianDictionary empty;
+    EXPECT_FALSE(empty.lookupBatch(keys)[0].has_value());
+    EXPECT_TRUE(dict.lookupBatch(std::vector<std::string_view>()).empty());
+}
+
+TEST_F(DictionaryTest, FreezeKeepsLookupSemantics) {
+    for (int i = 0; i < 200; ++i)
+        dict += std::make_pair("w" + std::to_string(i), "с" + std::to_string(i));
+    dict["empty"] = "";
+
+    FrozenDictionary frozen = dict.freeze();
+    EXPECT_EQ(frozen.count(), dict.count());
+    for (int i = 0; i < 200; ++i)
+        EXPECT_EQ(frozen["w" + std::to_string(i)], "с" + std::to_string(i));
+    EXPECT_EQ(frozen["w200"], "");
+    EXPECT_FALSE(frozen.contains("a"));
+    EXPECT_FALSE(frozen.contains("zzz"));
+    ASSERT_TRUE(frozen.find("empty").has_value());
+    EXPECT_TRUE(frozen.find("empty")->empty());
+
+    // Обход идёт в том же порядке, что и у исходного дерева
+    std::vector<std::string> expected, actual;
+    dict.forEach([&](std::string_view english, std::string_view) { expected.emplace_back(english); });
+    frozen.forEach([&](std::string_view english, std::string_view) { actual.emplace_back(english); });
+    EXPECT_EQ(actual, expected);
+}
+
+TEST_F(DictionaryTest, FrozenSaveAndOpen) {
+    const std::string filename = "frozen_test.bin";
+    dict += std::make_pair("apple", "яблоко");
+    dict += std::make_pair("banana", "банан");
+    dict += std::make_pair("cherry", "вишня");
+    ASSERT_TRUE(dict.freeze().save(filename));
+
+    FrozenDictionary opened;
+    EXPECT_EQ(opened.count(), 0);
+    ASSERT_TRUE(opened.open(filename));
+    EXPECT_EQ(opened.count(), 3);
+    EXPECT_EQ(opened["banana"], "банан");
+    EXPECT_EQ(opened["cherry"], "вишня");
+    EXPECT_EQ(opened["date"], "");
+
+    createTestFile(filename, "not a snapshot");
+    EXPECT_FALSE(opened.open(filename));
+    EXPECT_EQ(opened.count(), 3); // неудачное открытие не портит текущий снимок
+    std::remove(filename.c_str());
+}
+
+TEST_F(DictionaryTest, FrozenEntriesOutsideBlobReadAsEmpty) {
+    const std::string filename = "frozen_corrupt.bin";
+    dict += std::make_pair("apple", "яблоко");
+    dict += std::make_pair("banana", "банан");
+    ASSERT_TRUE(dict.freeze().save(filename));
+
+    // Заголовок — 24 байта, записи по 16: смещение, длина слова, длина перевода.
+    // Размеры файла остаются согласованными, портится только длина слова записи 2.
+    {
+        std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+        uint32_t keyLength = 1000;
+        file.seekp(24 + 16 * 2 + 8);
+        file.write(reinterpret_cast<const char*>(&keyLength), sizeof(keyLength));
+    }
+    // open() записи не читает; испорченная запись видна как пустые строки
+    FrozenDictionary opened;
+    ASSERT_TRUE(opened.open(filename));
+    EXPECT_EQ(opened.count(), 2);
+    EXPECT_FALSE(opened.verify());
+    size_t empty = 0;
+    opened.forEach([&](std::string_view english, std::string_view russian) {
+        empty += english.empty() && russian.empty();
+    });
+    EXPECT_EQ(empty, 1);
+    EXPECT_TRUE(dict.freeze().verify());
+
+    // Журнал читает снимок целиком и поэтому проверяет его при открытии
+    std::rename(filename.c_str(), "frozen_corrupt.snapshot");
+    std::remove("frozen_corrupt.journal");
+    JournaledDictionary journaled;
+    EXPECT_FALSE(journaled.open("frozen_corrupt"));
+    std::remove("frozen_corrupt.snapshot");
+    std::remove("frozen_corrupt.journal");
+}
+
+TEST(BTreeDictionaryTest, SameSemanticsAsTree) {
+    BTreeDictionary btree;
+    btree += std::make_pair("house", "дом");
+    btree += std::make_pair(std::string("car"), std::string("машина"));
+    btree += std::make_pair("house", "здание");
+    btree["cat"] = "кошка";
+
+    EXPECT_EQ(btree.count(), 3);
+    EXPECT_EQ(btree["house"], "здание");
+    EXPECT_EQ(btree["cat"], "кошка");
+
+    btree -= "car";
+    btree -= "missing";
+    const BTreeDictionary& const_btree = btree;
+    EXPECT_EQ(const_btree["car"], "");
+    EXPECT_EQ(btree.count(), 2);
+}
+
+TEST(BTreeDictionaryTest, MatchesRedBlackTreeUnderRandomOperations) {
+    BTreeDictionary btree;
+    EnglishRussianDictionary rbtree;
+    unsigned state = 12345;
+    for (int step = 0; step < 20000; ++step) {
+        state = state * 1103515245 + 12345;
+        std::string key = "k" + std::to_string((state >> 8) % 3000);
+        if ((state >> 4) % 3 == 0) {
+            btree -= key;
+            rbtree -= key;
+        }
+        else {
+            std::string value = std::to_string(step);
+            btree += std::make_pair(key, value);
+            rbtree += std::make_pair(key, value);
+        }
+        if (step % 2000 == 0) {
+            ASSERT_TRUE(btree.validate());
+        }
+    }
+    ASSERT_TRUE(btree.validate());
+    EXPECT_EQ(btree.count(), rbtree.count());
+
+    std::vector<std::pair<std::string, std::string>> expected, actual;
+    rbtree.forEach([&](std::string_view e, std::string_view r) { expected.emplace_back(e, r); });
+    btree.forEach([&](std::string_view e, std::string_view r) { actual.emplace_back(e, r); });
+    EXPECT_EQ(actual, expected);
+
+    // Удаление всех слов схлопывает дерево до пустого листа
+    for (const auto& word : expected)
+        btree -= word.first;
+    EXPECT_EQ(btree.count(), 0);
+    EXPECT_TRUE(btree.validate());
+}
+
+TEST(BTreeDictionaryTest, LoadFromFile) {
+    const std::string filename = "btree_dict.txt";
+    std::ofstream(filename) << "apple\nяблоко\nbanana\nбанан\napple\nяблоня\n";
+
+    BTreeDictionary btree;
+    EXPECT_TRUE(btree.load(filename));
+    EXPECT_EQ(btree.count(), 2);
+    EXPECT_EQ(btree["apple"], "яблоня");
+    EXPECT_FALSE(btree.load("non_existent_file.txt"));
+    std::remove(filename.c_str());
+}
+
+TEST_F(DictionaryTest, CopyIsDeepAndIndependent) {
+    for (int i = 0; i < 50; ++i)
+        dict += std::make_pair("w" + std::to_string(i), "с" + std::to_string(i));
+
+    EnglishRussianDictionary copy(dict);
+    EXPECT_TRUE(copy.validate());
+    copy -= "w1";
+    copy["w2"] = "другое";
+    EXPECT_EQ(copy.count(), 49);
+    EXPECT_EQ(dict.count(), 50);
+    EXPECT_EQ(dict["w2"], "с2");
+
+    dict = copy;
+    EXPECT_EQ(dict.count(), 49);
+    EXPECT_EQ(dict["w2"], "другое");
+    EXPECT_TRUE(dict.validate());
+}
+
+TEST(ConcurrentDictionaryTest, ReadersSeeConsistentVersions) {
+    ConcurrentDictionary shared;
+    shared += std::make_pair(std::string("base"), std::string("база"));
+
+    std::atomic<bool> done(false);
+    std::atomic<long> failures(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            size_t lastCount = 0;
+            while (!done.load()) {
+                // Слова только добавляются, поэтому число слов не убывает
+                size_t now = shared.count();
+                if (now < lastCount || shared["base"] != "база")
+                    failures++;
+                lastCount = now;
+            }
+        });
+    }
+    for (int i = 0; i < 500; ++i)
+        shared += std::make_pair("w" + std::to_string(i), std::to_string(i));
+    done.store(true);
+    for (std::thread& reader : readers)
+        reader.join();
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(shared.count(), 501);
+    EXPECT_EQ(shared["w499"], "499");
+    shared -= "base";
+    EXPECT_FALSE(shared.contains("base"));
+    EXPECT_TRUE(shared.read([](const EnglishRussianDictionary& d) { return d.validate(); }));
+}
+
+TEST(ShardedDictionaryTest, BatchesAndOrderedIteration) {
+    ShardedDictionary sharded(8);
+    std::vector<std::pair<std::string, std::string>> words;
+    for (int i = 0; i < 300; ++i)
+        words.push_back(std::make_pair("w" + std::to_string(i), std::to_string(i)));
+    words.push_back(std::make_pair("w7", "seven")); // последнее побеждает
+    sharded.add(words);
+
+    EXPECT_EQ(sharded.count(), 300);
+    EXPECT_EQ(sharded["w7"], "seven");
+    sharded.remove({ "w1", "w2", "missing" });
+    sharded -= "w3";
+    EXPECT_EQ(sharded.count(), 297);
+    EXPECT_FALSE(sharded.contains("w2"));
+
+    std::vector<std::string> keys;
+    sharded.forEach([&](std::string_view english, std::string_view) { keys.emplace_back(english); });
+    EXPECT_EQ(keys.size(), 297);
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+}
+
+TEST(ShardedDictionaryTest, ConcurrentWriters) {
+    ShardedDictionary sharded(4);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&sharded, t]() {
+            for (int i = 0; i < 200; ++i) {
+                std::string key = "t" + std::to_string(t) + "_" + std::to_string(i);
+                sharded += std::make_pair(key, key);
+                if (i % 2)
+                    sharded -= key;
+            }
+        });
+    }
+    for (std::thread& writer : writers)
+        writer.join();
+    EXPECT_EQ(sharded.count(), 400);
+    EXPECT_EQ(sharded["t3_10"], "t3_10");
+}
+
+TEST_F(DictionaryTest, IteratorsWalkInOrder) {
+    const char* words[] = { "delta", "alpha", "echo", "charlie", "bravo" };
+    for (const char* word : words)
+        dict += std::make_pair(word, word);
+
+    std::vector<std::string> forward;
+    for (auto entry : dict)
+        forward.emplace_back(entry.first);
+    EXPECT_EQ(forward, std::vector<std::string>({ "alpha", "bravo", "charlie", "delta", "echo" }));
+
+    std::vector<std::string> backward;
+    for (auto it = dict.end(); it != dict.begin();) {
+        --it;
+        backward.emplace_back(it.english());
+    }
+    EXPECT_EQ(backward, std::vector<std::string>({ "echo", "delta", "charlie", "bravo", "alpha" }));
+    EXPECT_EQ(std::distance(dict.begin(), dict.end()), 5);
+    EXPECT_TRUE(EnglishRussianDictionary().begin() == EnglishRussianDictionary().end());
+}
+
+TEST_F(DictionaryTest, BoundsAndEqualRange) {
+    dict += std::make_pair("b", "б");
+    dict += std::make_pair("d", "д");
+    dict += std::make_pair("f", "ф");
+
+    EXPECT_EQ(dict.lower_bound("d").english(), "d");
+    EXPECT_EQ(dict.lower_bound("c").english(), "d");
+    EXPECT_EQ(dict.upper_bound("d").english(), "f");
+    EXPECT_TRUE(dict.lower_bound("g") == dict.end());
+    EXPECT_EQ(dict.lower_bound("a").english(), "b");
+
+    auto found = dict.equal_range("d");
+    EXPECT_EQ(std::distance(found.first, found.second), 1);
+    EXPECT_EQ(found.first.russian(), "д");
+    auto missing = dict.equal_range("e");
+    EXPECT_TRUE(missing.first == missing.second);
+}
+
+TEST_F(DictionaryTest, PrefixRange) {
+    const char* words[] = { "in", "inter", "interact", "internal", "internet", "into", "intern", "is", "i" };
+    for (const char* word : words)
+        dict += std::make_pair(word, word);
+
+    std::vector<std::string> found;
+    for (auto entry : dict.prefix("inter"))
+        found.emplace_back(entry.first);
+    EXPECT_EQ(found, std::vector<std::string>({ "inter", "interact", "intern", "internal", "internet" }));
+
+    EXPECT_EQ(std::distance(dict.prefix("").begin(), dict.prefix("").end()), 9);
+    EXPECT_TRUE(dict.prefix("x").empty());
+    EXPECT_TRUE(dict.prefix("interz").empty());
+}
+
+TEST_F(DictionaryTest, HashIndexStaysInSync) {
+    EnglishRussianDictionary plain;
+    dict.enableHashIndex();
+    EXPECT_TRUE(dict.hasHashIndex());
+
+    unsigned state = 7;
+    for (int step = 0; step < 5000; ++step) {
+        state = state * 1103515245 + 12345;
+        std::string key = "k" + std::to_string((state >> 8) % 700);
+        switch ((state >> 4) % 4) {
+        case 0:
+            dict -= key;
+            plain -= key;
+            break;
+        case 1:
+            dict[key] = "v" + std::to_string(step);
+            plain[key] = "v" + std::to_string(step);
+            break;
+        default:
+            dict += std::make_pair(key, std::to_string(step));
+            plain += std::make_pair(key, std::to_string(step));
+        }
+    }
+    EXPECT_EQ(dict.count(), plain.count());
+    for (int i = 0; i < 800; ++i) {
+        std::string key = "k" + std::to_string(i);
+        EXPECT_EQ(dict.find(key), plain.find(key)) << key;
+    }
+
+    std::vector<std::string> storage;
+    for (int i = 0; i < 100; ++i)
+        storage.push_back("k" + std::to_string(i * 8));
+    std::vector<std::string_view> keys(storage.begin(), storage.end());
+    EXPECT_EQ(dict.lookupBatch(keys), plain.lookupBatch(keys));
+
+    // Индекс переживает перезагрузку, копирование и очистку
+    std::vector<std::pair<std::string, std::string>> words = { { "x", "икс" }, { "y", "игрек" } };
+    dict.assign(words);
+    EnglishRussianDictionary copy(dict);
+    EXPECT_TRUE(copy.hasHashIndex());
+    EXPECT_EQ(copy["y"], "игрек");
+    EXPECT_FALSE(copy.contains("k1"));
+    dict.clear();
+    EXPECT_FALSE(dict.contains("x"));
+
+    dict.enableHashIndex(false);
+    EXPECT_FALSE(dict.hasHashIndex());
+}
+
+TEST_F(DictionaryTest, PrefixComparisonKeepsStringOrder) {
+    std::vector<std::string> keys = {
+        "", "a", std::string("a\0", 2), std::string("a\0b", 3), "ab", "abcdefg", "abcdefgh",
+        "abcdefgh\x01", "abcdefghi", "abcdefgi", "zzzzzzzzzz", "\xd0\xb4\xd0\xbe\xd0\xbc",
+        "\xff", "\x7f", "international", "internationalize", "internet" };
+    for (size_t i = keys.size(); i-- > 0;)
+        dict += std::make_pair(keys[i], std::to_string(i));
+
+    std::vector<std::string> sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<std::string> walked;
+    for (auto entry : dict)
+        walked.emplace_back(entry.first);
+    EXPECT_EQ(walked, sorted);
+    EXPECT_TRUE(dict.validate());
+
+    for (size_t i = 0; i < keys.size(); ++i)
+        EXPECT_EQ(dict[keys[i]], std::to_string(i));
+    EXPECT_FALSE(dict.contains("abcdefgh\x02"));
+    EXPECT_EQ(dict.lower_bound("abcdefgh\x02").english(), "abcdefghi");
+}
+
+TEST_F(DictionaryTest, BloomFilterRejectsMisses) {
+    dict.enableBloomFilter();
+    for (int i = 0; i < 2000; ++i)
+        dict += std::make_pair("w" + std::to_string(i), std::to_string(i));
+
+    BloomFilter::Stats before = dict.bloomStats();
+    for (int i = 0; i < 2000; ++i)
+        ASSERT_TRUE(dict.contains("w" + std::to_string(i)));
+    for (int i = 0; i < 10000; ++i)
+        EXPECT_FALSE(dict.contains("miss" + std::to_string(i)));
+
+    // Счётчики ведутся по выборке ключей, поэтому сверяются с допуском
+    BloomFilter::Stats stats = dict.bloomStats();
+    EXPECT_GT(stats.bytes, 0);
+    EXPECT_NEAR(double(stats.queries - before.queries), 12000, 2400);
+    uint64_t misses = stats.rejected + stats.falsePositives - before.rejected - before.falsePositives;
+    EXPECT_NEAR(double(misses), 10000, 2000);
+    EXPECT_EQ(stats.queries % BloomFilter::sampling, 0);
+    EXPECT_LT(stats.falsePositiveRate, 0.05);
+    EXPECT_GT(stats.rejected, 0);
+}
+
+TEST(BloomFilterTest, FalsePositiveRateWithoutCounters) {
+    BloomFilter filter(2000);
+    for (int i = 0; i < 2000; ++i)
+        filter.add(hashKey("w" + std::to_string(i)));
+    for (int i = 0; i < 2000; ++i)
+        ASSERT_TRUE(filter.mayContain(hashKey("w" + std::to_string(i))));
+    int falsePositives = 0;
+    for (int i = 0; i < 10000; ++i)
+        falsePositives += filter.mayContain(hashKey("miss" + std::to_string(i))) ? 1 : 0;
+    EXPECT_LT(falsePositives, 500);
+}
+
+TEST_F(DictionaryTest, BloomFilterSurvivesRemovalsAndReloads) {
+    dict.enableBloomFilter();
+    for (int i = 0; i < 1000; ++i)
+        dict += std::make_pair("w" + std::to_string(i), std::to_string(i));
+    for (int i = 0; i < 900; ++i)
+        dict -= "w" + std::to_string(i);
+    EXPECT_EQ(dict.count(), 100);
+    const EnglishRussianDictionary& const_dict = dict;
+    EXPECT_EQ(const_dict["w5"], "");
+    EXPECT_EQ(const_dict["w950"], "950");
+
+    // После удаления и повторного добавления слово снова находится
+    dict += std::make_pair("w5", "пять");
+    EXPECT_EQ(const_dict["w5"], "пять");
+
+    dict.assign({ { "a", "а" } });
+    EXPECT_TRUE(dict.contains("a"));
+    EXPECT_FALSE(dict.contains("w950"));
+    EnglishRussianDictionary copy(dict);
+    EXPECT_TRUE(copy.hasBloomFilter());
+    EXPECT_TRUE(copy.contains("a"));
+
+    dict.enableBloomFilter(false);
+    EXPECT_EQ(dict.bloomStats().queries, 0);
+}
+
+TEST_F(DictionaryTest, EmplaceFamily) {
+    auto inserted = dict.try_emplace("sky", "небо");
+    EXPECT_TRUE(inserted.second);
+    EXPECT_EQ(inserted.first.russian(), "небо");
+
+    // try_emplace и emplace не перезаписывают существующее слово
+    auto existing = dict.try_emplace(std::string("sky"), "облака");
+    EXPECT_FALSE(existing.second);
+    EXPECT_EQ(existing.first.russian(), "небо");
+    EXPECT_FALSE(dict.emplace("sky", std::string("синь")).second);
+    EXPECT_EQ(dict["sky"], "небо");
+
+    // try_emplace собирает перевод из аргументов конструктора std::string
+    EXPECT_TRUE(dict.try_emplace("ha", size_t(3), 'x').second);
+    EXPECT_EQ(dict["ha"], "xxx");
+
+    auto assigned = dict.insert_or_assign("sky", "небеса");
+    EXPECT_FALSE(assigned.second);
+    EXPECT_EQ(dict["sky"], "небеса");
+    EXPECT_TRUE(dict.insert_or_assign(std::string("sea"), std::string("море")).second);
+    EXPECT_EQ(dict.count(), 3);
+    EXPECT_TRUE(dict.validate());
+}
+
+TEST_F(DictionaryTest, RvalueInsertMovesStrings) {
+    std::string english(100, 'e');
+    std::string russian(100, 'r');
+    const char* englishBuffer = english.data();
+    dict += std::make_pair(std::move(english), std::move(russian));
+
+    ASSERT_EQ(dict.count(), 1);
+    // Длинная строка перемещена в узел вместе со своим буфером
+    EXPECT_EQ(dict.begin().english().data(), englishBuffer);
+    EXPECT_EQ(dict[std::string(100, 'e')], std::string(100, 'r'));
+}
+
+TEST_F(DictionaryTest, MoveConstructionAndAssignment) {
+    dict.enableHashIndex();
+    for (int i = 0; i < 100; ++i)
+        dict += std::make_pair("w" + std::to_string(i), std::to_string(i));
+
+    EnglishRussianDictionary moved(std::move(dict));
+    EXPECT_EQ(moved.count(), 100);
+    EXPECT_TRUE(moved.hasHashIndex());
+    EXPECT_EQ(moved["w42"], "42");
+    EXPECT_EQ(dict.count(), 0);
+
+    // Перемещённый словарь остаётся пригодным к работе
+    dict += std::make_pair("fresh", "новый");
+    EXPECT_EQ(dict["fresh"], "новый");
+
+    dict = std::move(moved);
+    EXPECT_EQ(dict.count(), 100);
+    EXPECT_FALSE(dict.contains("fresh"));
+    EXPECT_TRUE(dict.validate());
+}
+
+TEST_F(DictionaryTest, LoadParallelMatchesSequentialLoad) {
+    const std::string filename = "test_parallel.txt";
+    // ~400 КБ: несколько кусков, повторы в разных кусках, слово без перевода в конце
+    std::string content;
+    for (int i = 0; i < 20000; ++i) {
+        int key = (i * 7919) % 15000;
+        content += "word" + std::to_string(key) + std::string(i % 5, 'x') + "\n";
+        content += "слово" + std::to_string(i) + "\n";
+    }
+    content += "orphan";
+    createTestFile(filename, content);
+
+    EnglishRussianDictionary expected;
+    ASSERT_TRUE(expected.load(filename));
+    std::vector<std::pair<std::string, std::string>> reference;
+    expected.forEach([&](std::string_view eng, std::string_view rus) {
+        reference.emplace_back(std::string(eng), std::string(rus));
+    });
+
+    for (unsigned threads : {1u, 2u, 3u, 7u}) {
+        for (auto mode : {EnglishRussianDictionary::LoadMode::Copy, EnglishRussianDictionary::LoadMode::Mapped}) {
+            ASSERT_TRUE(dict.loadParallel(filename, threads, mode));
+            EXPECT_TRUE(dict.validate());
+            std::vector<std::pair<std::string, std::string>> actual;
+            dict.forEach([&](std::string_view eng, std::string_view rus) {
+                actual.emplace_back(std::string(eng), std::string(rus));
+            });
+            EXPECT_EQ(actual, reference) << threads << " threads";
+        }
+    }
+    EXPECT_FALSE(dict.contains("orphan"));
+
+    std::remove(filename.c_str());
+}
+
+TEST(ParallelParserTest, SplitsOnLinePairBoundaries) {
+    // Короткие строки: границы кусков попадают и на слова, и на переводы
+    std::string text;
+    for (int i = 0; i < 50000; ++i)
+        text += (i % 2 ? "b" : "a") + std::to_string(i % 1000) + "\n" + std::to_string(i) + "\n";
+
+    for (unsigned threads : {1u, 2u, 5u, 16u}) {
+        auto pairs = parseSortedPairs(text.data(), text.size(), threads);
+        ASSERT_EQ(pairs.size(), 1000u) << threads;
+        for (size_t i = 1; i < pairs.size(); ++i)
+            EXPECT_LT(pairs[i - 1].first, pairs[i].first);
+        // Для a0 последнее вхождение — строка 49000
+        EXPECT_EQ(pairs.front().first, "a0");
+        EXPECT_EQ(pairs.front().second, "49000");
+    }
+    EXPECT_TRUE(parseSortedPairs(nullptr, 0).empty());
+    EXPECT_TRUE(parseSortedPairs("single", 6).empty());
+}
+
+TEST(ConcurrentDictionaryTest, ReloadAsyncKeepsServingOldVersion) {
+    // Две версии словаря: в каждой версия записана в переводе каждого слова
+    const std::string first = "reload_first.txt";
+    const std::string second = "reload_second.txt";
+    {
+        std::ofstream a(first), b(second);
+        for (int i = 0; i < 2000; ++i) {
+            a << "w" << i << "\nv1\n";
+            b << "w" << i << "\nv2\n";
+        }
+        b << "extra\nv2\n";
+    }
+
+    ConcurrentDictionary shared;
+    ASSERT_TRUE(shared.load(first));
+
+    std::atomic<bool> done(false);
+    std::atomic<long> failures(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&, t]() {
+            while (!done.load()) {
+                // Читатель видит одну версию целиком и никогда — пустой словарь
+                shared.read([&](const EnglishRussianDictionary& d) {
+                    std::optional<std::string_view> head = d.find("w0");
+                    std::optional<std::string_view> last = d.find("w" + std::to_string(1999 - t));
+                    size_t expected = head && *head == "v2" ? 2001 : 2000;
+                    if (!head || !last || *head != *last || d.count() != expected)
+                        failures++;
+                });
+            }
+        });
+    }
+    for (int i = 0; i < 6; ++i) {
+        std::future<bool> reloaded = shared.reloadAsync(i % 2 ? first : second,
+                                                        EnglishRussianDictionary::LoadMode::Mapped);
+        EXPECT_TRUE(reloaded.get());
+    }
+    EXPECT_FALSE(shared.reloadAsync("non_existent_file.txt").get());
+    done.store(true);
+    for (std::thread& reader : readers)
+        reader.join();
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(shared.count(), 2000); // неудачная перезагрузка ничего не меняет
+    EXPECT_EQ(shared["w5"], "v1");
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+}
+
+TEST(JournaledDictionaryTest, RecoversSnapshotAndJournal) {
+    const std::string path = "test_journal";
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+    {
+        JournaledDictionary journaled;
+        ASSERT_TRUE(journaled.open(path));
+        journaled += std::make_pair(std::string("apple"), std::string("яблоко"));
+        journaled += std::make_pair(std::string("banana"), std::string("банан"));
+        ASSERT_TRUE(journaled.compact()); // apple и banana уходят в снимок
+        journaled += std::make_pair(std::string("apple"), std::string("яблоня"));
+        journaled += std::make_pair(std::string("cherry"), std::string("вишня"));
+        journaled -= "banana";
+        EXPECT_GT(journaled.pendingSize(), 0);
+        EXPECT_TRUE(journaled.commit());
+        EXPECT_EQ(journaled.pendingSize(), 0);
+        journaled += std::make_pair(std::string("date"), std::string("финик")); // фиксируется при закрытии
+    }
+
+    JournaledDictionary recovered;
+    ASSERT_TRUE(recovered.open(path));
+    EXPECT_EQ(recovered.count(), 3);
+    EXPECT_EQ(recovered["apple"], "яблоня");
+    EXPECT_EQ(recovered["date"], "финик");
+    EXPECT_FALSE(recovered.contains("banana"));
+    EXPECT_TRUE(recovered.dictionary().validate());
+    recovered.close();
+
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+}
+
+TEST(JournaledDictionaryTest, DropsTornTailAndKeepsAppending) {
+    const std::string path = "test_torn";
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+    {
+        JournaledDictionary journaled;
+        ASSERT_TRUE(journaled.open(path));
+        journaled.setGroupCommitBytes(0);
+        journaled += std::make_pair(std::string("one"), std::string("один"));
+        journaled += std::make_pair(std::string("two"), std::string("два"));
+    }
+    {
+        // Обрыв посреди записи и мусор после неё
+        std::ofstream tail(path + ".journal", std::ios::binary | std::ios::app);
+        tail.write("\x01\x02\x03\x04\x05\x00\x00\x00\x01\x00\x00\x00+three", 18);
+    }
+    {
+        JournaledDictionary journaled;
+        ASSERT_TRUE(journaled.open(path));
+        EXPECT_EQ(journaled.count(), 2);
+        journaled += std::make_pair(std::string("three"), std::string("три"));
+    }
+
+    JournaledDictionary recovered;
+    ASSERT_TRUE(recovered.open(path));
+    EXPECT_EQ(recovered.count(), 3);
+    EXPECT_EQ(recovered["three"], "три");
+    recovered.close();
+
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+}
+
+TEST(JournaledDictionaryTest, CompactsAutomaticallyAndReplayIsIdempotent) {
+    const std::string path = "test_compact";
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+    std::string journalBeforeCompaction;
+    {
+        JournaledDictionary journaled;
+        ASSERT_TRUE(journaled.open(path));
+        journaled.setGroupCommitBytes(256);
+        journaled.setCompactionBytes(4096);
+        for (int i = 0; i < 1000; ++i)
+            journaled += std::make_pair("w" + std::to_string(i % 300), std::to_string(i));
+        for (int i = 0; i < 100; ++i)
+            journaled -= "w" + std::to_string(i);
+        ASSERT_TRUE(journaled.commit());
+        EXPECT_LT(journaled.journalSize(), 4096 + 512);
+
+        std::ifstream journal(path + ".journal", std::ios::binary);
+        journalBeforeCompaction.assign(std::istreambuf_iterator<char>(journal), std::istreambuf_iterator<char>());
+        ASSERT_TRUE(journaled.compact());
+    }
+    {
+        // Сбой между записью снимка и очисткой журнала: журнал применяется повторно
+        std::ofstream journal(path + ".journal", std::ios::binary | std::ios::trunc);
+        journal << journalBeforeCompaction;
+    }
+
+    JournaledDictionary recovered;
+    ASSERT_TRUE(recovered.open(path));
+    EXPECT_EQ(recovered.count(), 200);
+    EXPECT_FALSE(recovered.contains("w99"));
+    EXPECT_EQ(recovered["w100"], "700");
+    EXPECT_EQ(recovered["w299"], "899");
+    recovered.close();
+
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+}
+
+TEST(JournaledDictionaryTest, FailedSnapshotWriteKeepsJournal) {
+    FrozenDictionary frozen(std::vector<std::pair<std::string_view, std::string_view>>{ { "cat", "кот" } });
+    // Запись в /dev/full принимается в буфер и падает с ENOSPC только при сбросе
+    if (std::ifstream("/dev/full").is_open()) {
+        EXPECT_FALSE(frozen.save("/dev/full"));
+    }
+
+    const std::string path = "test_failed_compact";
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+    // Каталог на месте временного файла не даёт записать снимок
+    std::filesystem::create_directory(path + ".snapshot.tmp");
+    {
+        JournaledDictionary journaled;
+        ASSERT_TRUE(journaled.open(path));
+        journaled += std::make_pair("cat", "кот");
+        journaled += std::make_pair("dog", "собака");
+        ASSERT_TRUE(journaled.commit());
+        size_t journalSize = journaled.journalSize();
+        EXPECT_FALSE(journaled.compact());
+        EXPECT_EQ(journaled.journalSize(), journalSize);
+    }
+    EXPECT_FALSE(std::ifstream(path + ".snapshot").is_open());
+
+    JournaledDictionary recovered;
+    ASSERT_TRUE(recovered.open(path));
+    EXPECT_EQ(recovered.count(), 2);
+    EXPECT_EQ(recovered["dog"], "собака");
+    recovered.close();
+
+    std::filesystem::remove(path + ".snapshot.tmp");
+    std::remove((path + ".journal").c_str());
+}
+
+TEST(JournaledDictionaryTest, AutomaticCompactionFailureIsReported) {
+    const std::string path = "test_unhealthy";
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+    {
+        JournaledDictionary journaled;
+        ASSERT_TRUE(journaled.open(path));
+        journaled.setGroupCommitBytes(0);
+        journaled.setCompactionBytes(1);
+        journaled += std::make_pair("cat", "кот");
+        EXPECT_TRUE(journaled.healthy());
+        // Каталог на месте временного файла ломает следующую свёртку
+        std::filesystem::create_directory(path + ".snapshot.tmp");
+        journaled += std::make_pair("dog", "собака");
+        EXPECT_FALSE(journaled.healthy());
+        EXPECT_EQ(journaled.pendingSize(), 0u); // запись зафиксирована, не удалась только свёртка
+        EXPECT_TRUE(journaled.commit());
+        EXPECT_FALSE(journaled.healthy());
+    }
+    std::filesystem::remove(path + ".snapshot.tmp");
+
+    JournaledDictionary recovered;
+    ASSERT_TRUE(recovered.open(path));
+    EXPECT_TRUE(recovered.healthy());
+    EXPECT_EQ(recovered["dog"], "собака");
+    recovered.close();
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".journal").c_str());
+}
+
+TEST_F(DictionaryTest, SaveRoundTripsTextAndBinary) {
+    for (int i = 0; i < 3000; ++i)
+        dict += std::make_pair("word" + std::to_string(i), "слово " + std::to_string(i));
+    dict["word7"] = std::string(3 << 20, 'x'); // длиннее буфера вывода
+
+    ASSERT_TRUE(dict.save("test_save.txt"));
+    EnglishRussianDictionary text;
+    ASSERT_TRUE(text.load("test_save.txt"));
+    EXPECT_EQ(text.count(), dict.count());
+    EXPECT_TRUE(std::equal(text.begin(), text.end(), dict.begin(), dict.end()));
+
+    dict["multi"] = "строка\nещё строка"; // текстовый формат такое не переносит
+    ASSERT_TRUE(dict.saveBinary("test_save.bin"));
+    for (auto mode : {EnglishRussianDictionary::LoadMode::Copy, EnglishRussianDictionary::LoadMode::Mapped}) {
+        EnglishRussianDictionary binary;
+        ASSERT_TRUE(binary.loadBinary("test_save.bin", mode));
+        EXPECT_TRUE(binary.validate());
+        EXPECT_TRUE(std::equal(binary.begin(), binary.end(), dict.begin(), dict.end()));
+        EXPECT_EQ(binary["multi"], "строка\nещё строка");
+    }
+
+    // Обрезанный файл и файл другого формата не загружаются и не портят словарь
+    std::ifstream in("test_save.bin", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    createTestFile("test_save.bin", bytes.substr(0, bytes.size() - 3));
+    size_t words = dict.count();
+    EXPECT_FALSE(dict.loadBinary("test_save.bin"));
+    EXPECT_EQ(dict.count(), words);
+    EXPECT_FALSE(dict.loadBinary("test_save.txt"));
+    EXPECT_EQ(dict["multi"], "строка\nещё строка");
+
+    // Нехватка места обнаруживается и при записи хвоста из буфера потока
+    if (std::ifstream("/dev/full").is_open()) {
+        EnglishRussianDictionary small;
+        small += std::make_pair("cat", "кот");
+        EXPECT_FALSE(small.save("/dev/full"));
+        EXPECT_FALSE(small.saveBinary("/dev/full"));
+    }
+
+    EnglishRussianDictionary empty;
+    ASSERT_TRUE(empty.saveBinary("test_save.bin"));
+    EXPECT_TRUE(dict.loadBinary("test_save.bin"));
+    EXPECT_EQ(dict.count(), 0);
+
+    std::remove("test_save.txt");
+    std::remove("test_save.bin");
+}
+
+TEST_F(DictionaryTest, CompressedDictionaryMatchesTree) {
+    // Длинные общие префиксы, слова-префиксы друг друга, границы блоков
+    const char* stems[] = { "inter", "international", "internationalization", "under", "understand", "a", "" };
+    for (const char* stem : stems)
+        for (int i = 0; i < 40; ++i)
+            dict += std::make_pair(std::string(stem) + std::to_string(i), "перевод " + std::to_string(i));
+    dict += std::make_pair("inter", "между");
+    dict += std::make_pair("", "пусто");
+
+    CompressedDictionary compressed = dict.compress();
+    EXPECT_EQ(compressed.count(), dict.count());
+    for (auto entry : dict)
+        EXPECT_EQ(compressed.find(entry.first), entry.second) << entry.first;
+
+    const char* misses[] = { "inte", "inter0a", "international400", "zzz", "\x01", "under39x", "b" };
+    for (const char* miss : misses) {
+        EXPECT_FALSE(compressed.contains(miss)) << miss;
+        EXPECT_EQ(compressed[miss], "");
+    }
+
+    std::vector<std::pair<std::string, std::string>> visited;
+    compressed.forEach([&](std::string_view english, std::string_view russian) {
+        visited.emplace_back(std::string(english), std::string(russian));
+    });
+    EXPECT_TRUE(std::equal(visited.begin(), visited.end(), dict.begin(), dict.end(),
+                           [](const std::pair<std::string, std::string>& a,
+                              std::pair<std::string_view, std::string_view> b) {
+                               return a.first == b.first && a.second == b.second;
+                           }));
+
+    EXPECT_FALSE(CompressedDictionary().contains("a"));
+    EXPECT_LT(compressed.memoryUsage(), dict.memoryUsage());
+}
+
+TEST_F(DictionaryTest, CompressedDictionaryLoadsFromFile) {
+    const std::string filename = "test_compressed.txt";
+    createTestFile(filename, "apple\nяблоко\napplet\nапплет\napple\nяблоня\n");
+
+    CompressedDictionary compressed;
+    ASSERT_TRUE(compressed.load(filename));
+    EXPECT_EQ(compressed.count(), 2);
+    EXPECT_EQ(compressed["apple"], "яблоня");
+    EXPECT_EQ(compressed["applet"], "апплет");
+    EXPECT_GT(compressed.memoryUsage(), 0);
+    EXPECT_FALSE(compressed.load("non_existent_file.txt"));
+
+    std::remove(filename.c_str());
+}
+
+TEST(EditDistanceTest, BitParallelMatchesPlainDynamicProgramming) {
+    auto plain = [](const std::string& a, const std::string& b) {
+        std::vector<size_t> row(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); ++j) row[j] = j;
+        for (size_t i = 1; i <= a.size(); ++i) {
+            size_t diagonal = row[0];
+            row[0] = i;
+            for (size_t j = 1; j <= b.size(); ++j) {
+                size_t above = row[j];
+                row[j] = std::min(std::min(row[j], row[j - 1]) + 1, diagonal + (a[i - 1] != b[j - 1]));
+                diagonal = above;
+            }
+        }
+        return row[b.size()];
+    };
+
+    unsigned seed = 7;
+    auto random = [&seed]() { return seed = seed * 1103515245 + 12345; };
+    for (int test = 0; test < 300; ++test) {
+        std::string a, b;
+        size_t lengthA = random() % 80, lengthB = random() % 80;
+        for (size_t i = 0; i < lengthA; ++i) a += char('a' + random() % 4);
+        for (size_t i = 0; i < lengthB; ++i) b += char('a' + random() % 4);
+        EXPECT_EQ(editDistance(a, b), plain(a, b)) << a << " " << b;
+    }
+    EXPECT_EQ(editDistance("", "abc"), 3);
+    EXPECT_EQ(editDistance("kitten", "sitting"), 3);
+}
+
+TEST_F(DictionaryTest, SuggestMatchesBruteForce) {
+    unsigned seed = 11;
+    auto random = [&seed]() { return seed = seed * 1103515245 + 12345; };
+    auto randomWord = [&](size_t maxLength) {
+        std::string word;
+        size_t length = 1 + (random() >> 8) % maxLength;
+        for (size_t i = 0; i < length; ++i) word += char('a' + (random() >> 8) % 5);
+        return word;
+    };
+    for (int i = 0; i < 3000; ++i)
+        dict += std::make_pair(randomWord(8), std::string("п"));
+    dict += std::make_pair(std::string(70, 'a'), std::string("длинное"));
+
+    std::vector<std::string> queries = { "", "abc", "eeeee", "abcdeabc", std::string(69, 'a') + "b" };
+    for (int i = 0; i < 30; ++i)
+        queries.push_back(randomWord(9));
+
+    auto checkAll = [&]() {
+        for (const std::string& query : queries) {
+            for (size_t maxDistance : { 0, 1, 2, 3 }) {
+                for (size_t limit : { 1, 5, 50 }) {
+                    std::vector<std::pair<size_t, std::string>> expected;
+                    dict.forEach([&](std::string_view english, std::string_view) {
+                        size_t distance = editDistance(english, query);
+                        if (distance <= maxDistance)
+                            expected.emplace_back(distance, std::string(english));
+                    });
+                    std::sort(expected.begin(), expected.end());
+                    if (expected.size() > limit) expected.resize(limit);
+
+                    std::vector<std::pair<size_t, std::string>> actual;
+                    for (const auto& suggestion : dict.suggest(query, maxDistance, limit))
+                        actual.emplace_back(suggestion.distance, std::string(suggestion.english));
+                    EXPECT_EQ(actual, expected) << query << " d=" << maxDistance << " k=" << limit;
+                }
+            }
+        }
+    };
+    checkAll();
+
+    // Массивы ключей для suggest() перестраиваются после изменений
+    for (int i = 0; i < 300; ++i) {
+        dict -= randomWord(8);
+        dict += std::make_pair(randomWord(9), std::string("н"));
+    }
+    checkAll();
+    EXPECT_EQ(dict.suggest(std::string(70, 'a'), 0).front().russian, "длинное");
+    EXPECT_TRUE(dict.suggest("abc", 2, 0).empty());
+}
+
+TEST_F(DictionaryTest, ReverseIndexFollowsWrites) {
+    dict += std::make_pair("hedgehog", "ёж");
+    dict += std::make_pair("apple", "яблоко");
+    dict.enableReverseIndex();
+    EXPECT_TRUE(dict.hasReverseIndex());
+    dict += std::make_pair("pome", "яблоко");
+    dict += std::make_pair(std::string("urchin"), std::string("ёж"));
+
+    EXPECT_EQ(dict.findEnglish("яблоко"), (std::vector<std::string_view>{ "apple", "pome" }));
+    EXPECT_EQ(dict.findEnglish("ёж"), (std::vector<std::string_view>{ "hedgehog", "urchin" }));
+    EXPECT_TRUE(dict.findEnglish("еж").empty()); // ё и е различаются
+
+    // Переназначение, удаление и запись через ссылку
+    dict += std::make_pair("pome", "плод");
+    dict -= "apple";
+    EXPECT_TRUE(dict.findEnglish("яблоко").empty());
+    dict["urchin"] = "морской ёж";
+    EXPECT_EQ(dict.findEnglish("морской ёж"), (std::vector<std::string_view>{ "urchin" }));
+    EXPECT_EQ(dict.findEnglish("ёж"), (std::vector<std::string_view>{ "hedgehog" }));
+    dict["cat"] = "кошка";
+    EXPECT_EQ(dict.findEnglish("кошка"), (std::vector<std::string_view>{ "cat" }));
+    EXPECT_EQ(dict.findEnglish("морской ёж"), (std::vector<std::string_view>{ "urchin" }));
+    dict.insert_or_assign(std::string("cat"), std::string("кот"));
+    dict.try_emplace("tomcat", "кот");
+    EXPECT_EQ(dict.findEnglish("кот"), (std::vector<std::string_view>{ "cat", "tomcat" }));
+    EXPECT_TRUE(dict.findEnglish("кошка").empty());
+    dict["tomcat"] = "котяра";
+    dict["tomcat"] += "!";
+    EXPECT_EQ(dict.findEnglish("котяра!"), (std::vector<std::string_view>{ "tomcat" }));
+    dict -= "tomcat";
+    EXPECT_TRUE(dict.findEnglish("котяра!").empty());
+    EXPECT_EQ(dict.findEnglish("кот"), (std::vector<std::string_view>{ "cat" }));
+
+    // Копия, перезагрузка и отключение
+    EnglishRussianDictionary copy(dict);
+    EXPECT_TRUE(copy.hasReverseIndex());
+    EXPECT_EQ(copy.findEnglish("плод"), (std::vector<std::string_view>{ "pome" }));
+    const std::string filename = "test_reverse.txt";
+    createTestFile(filename, "one\nодин\nuno\nодин\n");
+    ASSERT_TRUE(dict.load(filename, EnglishRussianDictionary::LoadMode::Mapped));
+    EXPECT_EQ(dict.findEnglish("один"), (std::vector<std::string_view>{ "one", "uno" }));
+    EXPECT_TRUE(dict.findEnglish("кот").empty());
+    dict.enableReverseIndex(false);
+    EXPECT_EQ(dict.findEnglish("один"), (std::vector<std::string_view>{ "one", "uno" }));
+    std::remove(filename.c_str());
+}
+
+TEST_F(DictionaryTest, ReverseIndexMatchesScanUnderRandomWrites) {
+    dict.enableReverseIndex();
+    EnglishRussianDictionary plain;
+    unsigned seed = 5;
+    auto random = [&seed]() { return (seed = seed * 1103515245 + 12345) >> 8; };
+    for (int i = 0; i < 4000; ++i) {
+        std::string english = "w" + std::to_string(random() % 300);
+        std::string russian = "п" + std::to_string(random() % 40);
+        switch (random() % 4) {
+        case 0:
+            dict -= english;
+            plain -= english;
+            break;
+        case 1:
+            dict[english] = russian;
+            plain[english] = russian;
+            break;
+        default:
+            dict += std::make_pair(english, russian);
+            plain += std::make_pair(english, russian);
+        }
+        if (i % 97 == 0) {
+            for (int t = 0; t < 40; ++t) {
+                std::string russianKey = "п" + std::to_string(t);
+                ASSERT_EQ(dict.findEnglish(russianKey), plain.findEnglish(russianKey)) << i;
+            }
+        }
+    }
+}
+
+TEST_F(DictionaryTest, MergeDifferenceAndDiff) {
+    // Большой и маленький второй словарь проходят разными путями
+    for (size_t overlaySize : { size_t(5), size_t(600) }) {
+        EnglishRussianDictionary base, overlay, expected;
+        base.enableHashIndex();
+        base.enableReverseIndex();
+        for (int i = 0; i < 1000; i += 2) {
+            base += std::make_pair("w" + std::to_string(i), "база " + std::to_string(i));
+            expected += std::make_pair("w" + std::to_string(i), "база " + std::to_string(i));
+        }
+        for (size_t i = 0; i < overlaySize; ++i) {
+            std::string english = "w" + std::to_string(i * 3);
+            overlay += std::make_pair(english, "слой " + std::to_string(i));
+            expected += std::make_pair(english, "слой " + std::to_string(i));
+        }
+
+        EnglishRussianDictionary before(base);
+        base += overlay;
+        EXPECT_TRUE(base.validate());
+        EXPECT_EQ(base.count(), expected.count());
+        EXPECT_TRUE(std::equal(base.begin(), base.end(), expected.begin(), expected.end()));
+        EXPECT_EQ(base["w3"], "слой 1");
+        EXPECT_EQ(base.findEnglish("слой 1"), (std::vector<std::string_view>{ "w3" }));
+
+        EnglishRussianDictionary::Diff changes = before.diff(base);
+        EXPECT_TRUE(changes.removed.empty());
+        size_t overlapping = 0;
+        for (size_t i = 0; i < overlaySize; ++i)
+            overlapping += (i * 3) % 2 == 0 && i * 3 < 1000;
+        EXPECT_EQ(changes.changed.size(), overlapping);
+        EXPECT_EQ(changes.added.size(), overlaySize - overlapping);
+        EXPECT_TRUE(std::is_sorted(changes.added.begin(), changes.added.end()));
+
+        base -= overlay;
+        EXPECT_TRUE(base.validate());
+        EXPECT_EQ(base.count(), expected.count() - overlaySize);
+        EXPECT_FALSE(base.contains("w0"));
+        EXPECT_FALSE(base.contains("w3"));
+        EXPECT_TRUE(base.contains("w2"));
+        EXPECT_TRUE(base.findEnglish("слой 1").empty());
+        EXPECT_EQ(base.diff(base).changed.size(), 0);
+    }
+
+    dict += std::make_pair("a", "а");
+    dict += dict;
+    EXPECT_EQ(dict.count(), 1);
+    EnglishRussianDictionary other;
+    other += std::make_pair("a", "б");
+    EnglishRussianDictionary::Diff changes = dict.diff(other);
+    ASSERT_EQ(changes.changed.size(), 1);
+    EXPECT_EQ(changes.changed[0].before, "а");
+    EXPECT_EQ(changes.changed[0].after, "б");
+    dict -= dict;
+    EXPECT_EQ(dict.count(), 0);
+}
+
+TEST_F(DictionaryTest, DifferenceRemovingEveryWordResetsIndexes) {
+    EnglishRussianDictionary base, overlay;
+    base.enableHashIndex();
+    base.enableBloomFilter();
+    base.enableReverseIndex();
+    for (int i = 0; i < 600; ++i) {
+        base += std::make_pair("w" + std::to_string(i), std::string("перевод"));
+        overlay += std::make_pair("w" + std::to_string(i), std::string("другой"));
+    }
+    base["w7"] = "седьмой";
+
+    base -= overlay;
+    EXPECT_EQ(base.count(), 0);
+    EXPECT_TRUE(base.validate());
+    EXPECT_FALSE(base.find("w1").has_value());
+    EXPECT_FALSE(base.contains("w7"));
+    EXPECT_TRUE(base.findEnglish("перевод").empty());
+    EXPECT_TRUE(base.findEnglish("седьмой").empty());
+
+    base += std::make_pair("w1", "снова");
+    EXPECT_EQ(base["w1"], "снова");
+    EXPECT_EQ(base.findEnglish("снова"), (std::vector<std::string_view>{ "w1" }));
+    EXPECT_TRUE(base.findEnglish("перевод").empty());
+}
+
+TEST_F(DictionaryTest, RankSelectAndCountRangeUnderRandomWrites) {
+    std::set<std::string> expected;
+    unsigned seed = 11;
+    auto random = [&seed]() { return (seed = seed * 1103515245 + 12345) >> 8; };
+    for (int i = 0; i < 3000; ++i) {
+        std::string english = "w" + std::to_string(random() % 500);
+        if (random() % 3 == 0) {
+            dict -= english;
+            expected.erase(english);
+        }
+        else {
+            dict += std::make_pair(english, std::string("п"));
+            expected.insert(english);
+        }
+        if (i % 211 == 0) {
+            ASSERT_TRUE(dict.validate()) << i;
+            std::vector<std::string> sorted(expected.begin(), expected.end());
+            for (size_t k = 0; k < sorted.size(); ++k) {
+                ASSERT_EQ(dict.select(k).english(), sorted[k]);
+                ASSERT_EQ(dict.rank(sorted[k]), k);
+            }
+            EXPECT_TRUE(dict.select(sorted.size()) == dict.end());
+            std::string probe = "w" + std::to_string(random() % 500) + "5";
+            size_t less = std::lower_bound(sorted.begin(), sorted.end(), probe) - sorted.begin();
+            EXPECT_EQ(dict.rank(probe), less);
+            EXPECT_EQ(dict.countRange("w1", "w3"),
+                      size_t(std::lower_bound(sorted.begin(), sorted.end(), "w3") -
+                             std::lower_bound(sorted.begin(), sorted.end(), "w1")));
+        }
+    }
+    EXPECT_EQ(dict.countRange("w3", "w1"), 0u);
+}
+
+TEST_F(DictionaryTest, OrderStatisticsAfterBulkOperations) {
+    std::vector<std::pair<std::string, std::string>> words;
+    for (int i = 0; i < 1000; ++i)
+        words.emplace_back("k" + std::to_string(10000 + i), "з");
+    dict.assign(words);
+    EXPECT_TRUE(dict.validate());
+    EXPECT_EQ(dict.select(500).english(), "k10500");
+    EXPECT_EQ(dict.rank("k10500"), 500u);
+
+    EnglishRussianDictionary copy(dict);
+    copy -= std::string("k10000");
+    EXPECT_TRUE(copy.validate());
+    EXPECT_EQ(copy.select(0).english(), "k10001");
+    EXPECT_EQ(copy.countRange("k10000", "k10100"), 99u);
+
+    std::mt19937 random(3);
+    std::set<std::string> seen;
+    for (int i = 0; i < 200; ++i) {
+        auto it = copy.sample(random);
+        ASSERT_TRUE(it != copy.end());
+        seen.insert(std::string(it.english()));
+    }
+    EXPECT_GT(seen.size(), 100u);
+    EnglishRussianDictionary empty;
+    EXPECT_TRUE(empty.sample(random) == empty.end());
+}
+
+TEST(PersistentDictionaryTest, SnapshotsKeepTheirVersion) {
+    PersistentDictionary dict;
+    dict += std::make_pair("cat", "кот");
+    dict += std::make_pair("dog", "собака");
+    PersistentDictionary::Snapshot first = dict.snapshot();
+
+    dict += std::make_pair("cat", "кошка");
+    dict += std::make_pair("owl", "сова");
+    dict -= "dog";
+    PersistentDictionary::Snapshot second = dict.snapshot();
+
+    EXPECT_EQ(first.count(), 2u);
+    EXPECT_EQ(first["cat"], "кот");
+    EXPECT_EQ(first["dog"], "собака");
+    EXPECT_FALSE(first.contains("owl"));
+
+    EXPECT_EQ(second.count(), 2u);
+    EXPECT_EQ(second["cat"], "кошка");
+    EXPECT_FALSE(second.contains("dog"));
+    EXPECT_EQ(dict["owl"], "сова");
+
+    dict.restore(first);
+    EXPECT_EQ(dict["cat"], "кот");
+    EXPECT_EQ(dict.count(), 2u);
+    EXPECT_EQ(second["owl"], "сова");
+    EXPECT_TRUE(first.validate());
+    EXPECT_TRUE(second.validate());
+}
+
+TEST(PersistentDictionaryTest, VersionsMatchPlainCopiesUnderRandomWrites) {
+    PersistentDictionary dict;
+    std::map<std::string, std::string> model;
+    std::vector<PersistentDictionary::Snapshot> versions;
+    std::vector<std::map<std::string, std::string>> expected;
+    unsigned seed = 17;
+    auto random = [&seed]() { return (seed = seed * 1103515245 + 12345) >> 8; };
+    for (int i = 0; i < 5000; ++i) {
+        std::string english = "w" + std::to_string(random() % 700);
+        if (random() % 3 == 0) {
+            dict -= english;
+            model.erase(english);
+        }
+        else {
+            std::string russian = "п" + std::to_string(random() % 10);
+            dict += std::make_pair(english, russian);
+            model[english] = russian;
+        }
+        if (i % 250 == 0) {
+            versions.push_back(dict.snapshot());
+            expected.push_back(model);
+            // Часть версий отпускается, чтобы их узлы освобождались посреди правок
+            if (versions.size() % 3 == 0) {
+                versions.erase(versions.begin());
+                expected.erase(expected.begin());
+            }
+        }
+    }
+    ASSERT_TRUE(dict.validate());
+    for (size_t v = 0; v < versions.size(); ++v) {
+        ASSERT_TRUE(versions[v].validate());
+        std::map<std::string, std::string> seen;
+        versions[v].forEach([&seen](std::string_view english, std::string_view russian) {
+            seen.emplace(english, russian);
+        });
+        EXPECT_EQ(seen, expected[v]) << v;
+    }
+}
+
+TEST(PersistentDictionaryTest, VersionsShareUnchangedNodes) {
+    EnglishRussianDictionary source;
+    for (int i = 0; i < 20000; ++i)
+        source += std::make_pair("word" + std::to_string(i), "перевод номер " + std::to_string(i));
+    PersistentDictionary dict(source);
+    EXPECT_EQ(dict.count(), source.count());
+    EXPECT_TRUE(dict.validate());
+
+    std::vector<PersistentDictionary::Snapshot> versions;
+    for (int version = 0; version < 30; ++version) {
+        for (int edit = 0; edit < 10; ++edit)
+            dict += std::make_pair("word" + std::to_string(version * 613 + edit), "правка " + std::to_string(version));
+        versions.push_back(dict.snapshot());
+    }
+    size_t single = PersistentDictionary::memoryUsage({ versions.back() });
+    size_t all = PersistentDictionary::memoryUsage(versions);
+    EXPECT_LT(all, single * 2);
+    EXPECT_EQ(versions.front()["word0"], "правка 0");
+    EXPECT_EQ(versions.front()["word613"], "перевод номер 613");
+    EXPECT_EQ(versions.back()["word613"], "правка 1");
+}
+
+TEST(PersistentDictionaryTest, SnapshotsReadWhileWriterEdits) {
+    PersistentDictionary dict;
+    for (int i = 0; i < 2000; ++i)
+        dict += std::make_pair("k" + std::to_string(i), std::string("старое"));
+    PersistentDictionary::Snapshot frozen = dict.snapshot();
+
+    std::atomic<bool> mismatch(false);
+    std::thread reader([&frozen, &mismatch]() {
+        for (int round = 0; round < 20; ++round)
+            for (int i = 0; i < 2000; ++i)
+                if (frozen["k" + std::to_string(i)] != "старое") mismatch = true;
+    });
+    for (int i = 0; i < 2000; ++i) {
+        dict += std::make_pair("k" + std::to_string(i), std::string("новое"));
+        if (i % 2) dict -= "k" + std::to_string(i);
+        if (i % 100 == 0) dict.snapshot(); // временная версия сразу освобождается
+    }
+    reader.join();
+    EXPECT_FALSE(mismatch);
+    EXPECT_EQ(dict.count(), 1000u);
+    EXPECT_TRUE(frozen.validate());
+}
+
+TEST_F(DictionaryTest, MetricsDescribeTreeShape) {
+    for (int i = 0; i < 1000; ++i)
+        dict += std::make_pair("w" + std::to_string(i), std::string("п"));
+    DictionaryMetrics metrics = dict.metrics();
+    EXPECT_EQ(metrics.nodes, 1000u);
+    // Высота красно-черного дерева не больше 2 log2(n + 1), чёрная — не меньше половины высоты
+    EXPECT_LE(metrics.height, 20);
+    EXPECT_GE(metrics.blackHeight * 2, metrics.height);
+    EXPECT_GE(metrics.nodeBytes, 1000 * sizeof(void*));
+    EXPECT_GE(metrics.memoryBytes, metrics.nodeBytes);
+    EXPECT_NE(metrics.toString().find("black_height "), std::string::npos);
+
+    EXPECT_EQ(EnglishRussianDictionary().metrics().height, 0);
+}
+
+TEST_F(DictionaryTest, MetricsCountHotPathWhenEnabled) {
+    for (int i = 0; i < 1000; ++i)
+        dict += std::make_pair("w" + std::to_string(i), std::string("п"));
+    for (int i = 0; i < 500; ++i)
+        dict -= "w" + std::to_string(i * 2);
+    dict.resetMetrics();
+    for (int i = 0; i < 100; ++i)
+        dict.contains("w" + std::to_string(i));
+    dict += std::make_pair("extra", "ещё");
+
+    DictionaryMetrics metrics = dict.metrics();
+    if (!metrics.counting) {
+        EXPECT_EQ(metrics.lookups, 0u);
+        EXPECT_EQ(metrics.comparisons, 0u);
+        return;
+    }
+    EXPECT_EQ(metrics.lookups, 100u);
+    EXPECT_GE(metrics.treeSearches, 100u);
+    EXPECT_GT(metrics.comparisonsPerSearch(), 1.0);
+    EXPECT_LE(metrics.comparisonsPerSearch(), double(metrics.height));
+    uint64_t timed = 0;
+    for (uint64_t bucket : metrics.latency)
+        timed += bucket;
+    EXPECT_GT(timed, 0u);
+    EXPECT_LE(timed, 100u / DictionaryMetrics::latencySampling + 1);
+    EXPECT_GT(metrics.latencyPercentileNanoseconds(0.99), 0u);
+
+    EnglishRussianDictionary other;
+    for (int i = 0; i < 100; ++i)
+        other += std::make_pair("k" + std::to_string(i), std::string("п"));
+    EXPECT_GT(other.metrics().insertRotations, 0u);
+    for (int i = 0; i < 100; ++i)
+        other -= "k" + std::to_string(i);
+    EXPECT_GT(other.metrics().deleteRotations, 0u);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();